@@ -1,3 +1,3 @@
-for /L %%i in (1,1,20) do (
-    start cmd.exe /k "cd /d Schoenemann && null.exe datagen && exit"
-)
\ No newline at end of file
+cd /d Schoenemann
+rem Rerunning this after an interruption resumes the run from its last checkpoint
+null.exe datagen threads=20 positions=100000000 out=output.bin
@@ -94,17 +94,62 @@ public:
         acc.loadBias(innerNet.featureBias);
     }
 
+    // The input indices of a piece from white's and black's point of view
+    static void featureIndices(const std::uint8_t piece, const std::uint8_t color, const std::uint8_t square,
+                               std::uint16_t &whiteIndex, std::uint16_t &blackIndex) {
+        const std::uint16_t pieceIndex = piece * whiteSquares;
+        whiteIndex = color * blackSqures + pieceIndex + square;
+        blackIndex = (color ^ 1) * blackSqures + pieceIndex + (square ^ 56);
+    }
+
+    // Builds both accumulators from scratch in one pass. A tile of the hidden layer stays in registers
+    // while the weights of all features are added, instead of a load and store per feature and value
+    void refreshAccumulator(const std::uint16_t *whiteFeatures, const std::uint16_t *blackFeatures, const int count) {
+#ifdef __AVX2__
+        // 4 registers for every perspective, so both tiles fit into the 16 registers of AVX2
+        constexpr int registers = 4;
+        constexpr int tileSize = registers * 16;
+
+        for (int offset = 0; offset < hiddenSize; offset += tileSize) {
+            __m256i white[registers];
+            __m256i black[registers];
+            for (int r = 0; r < registers; r++) {
+                white[r] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&innerNet.featureBias[offset + r * 16]));
+                black[r] = white[r];
+            }
+
+            for (int feature = 0; feature < count; feature++) {
+                const std::int16_t *whiteRow = &innerNet.featureWeight[whiteFeatures[feature] * hiddenSize + offset];
+                const std::int16_t *blackRow = &innerNet.featureWeight[blackFeatures[feature] * hiddenSize + offset];
+                for (int r = 0; r < registers; r++) {
+                    white[r] = _mm256_add_epi16(white[r], _mm256_loadu_si256(
+                                                    reinterpret_cast<const __m256i *>(whiteRow + r * 16)));
+                    black[r] = _mm256_add_epi16(black[r], _mm256_loadu_si256(
+                                                    reinterpret_cast<const __m256i *>(blackRow + r * 16)));
+                }
+            }
+
+            for (int r = 0; r < registers; r++) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(&acc.white[offset + r * 16]), white[r]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(&acc.black[offset + r * 16]), black[r]);
+            }
+        }
+#else
+        refreshAccumulator();
+        for (int feature = 0; feature < count; feature++) {
+            util::addAll(acc.white, acc.black, innerNet.featureWeight, whiteFeatures[feature] * hiddenSize,
+                         blackFeatures[feature] * hiddenSize);
+        }
+#endif
+    }
+
     void updateAccumulator(
         const std::uint8_t piece,
         const std::uint8_t color,
         const std::uint8_t square,
         const bool operation) {
-        // Calculate the stride necessary to get to the correct piece:
-        const std::uint16_t pieceIndex = piece * whiteSquares;
-
-        // Get the square index based on the color
-        const std::uint16_t whiteIndex = color * blackSqures + pieceIndex + square;
-        const std::uint16_t blackIndex = (color ^ 1) * blackSqures + pieceIndex + (square ^ 56);
+        std::uint16_t whiteIndex, blackIndex;
+        featureIndices(piece, color, square, whiteIndex, blackIndex);
 
         // Update the accumolator
         if (operation == activate) {
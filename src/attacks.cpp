@@ -0,0 +1,36 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chess.hpp"
+
+// The lookup tables are generated by the compiler, so there is no work left at startup.
+// They are defined in this translation unit only, because generating them is expensive
+// and every other file just needs to link against them.
+namespace chess {
+    constinit const attacks::SliderTable<0x19000> attacks::RookTable =
+            initSliders<0x19000>(RookMagics, rookAttacks);
+
+    constinit const attacks::SliderTable<0x1480> attacks::BishopTable =
+            initSliders<0x1480>(BishopMagics, bishopAttacks);
+
+    constinit const std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB =
+            init_squares_between();
+
+    constinit const cuckoo::Table cuckoo::TABLE = init();
+}
@@ -31,7 +31,6 @@ VERSION: 0.6.76
 #ifndef CHESS_HPP
 #define CHESS_HPP
 
-#include <functional>
 #include <utility>
 
 #include <cstdint>
@@ -706,21 +705,33 @@ namespace chess {
         struct Magic {
             U64 mask;
             U64 magic;
-            Bitboard *attacks;
+            // Offset of the first entry of this square inside the attack table
+            std::uint32_t offset;
             U64 shift;
 
-            U64 operator()(Bitboard b) const { return (((b & mask)).getBits() * magic) >> shift; }
+            constexpr U64 operator()(Bitboard b) const { return (((b & mask)).getBits() * magic) >> shift; }
         };
 
+        // Magic lookup for every square together with the attack table they index into
+        template<std::size_t N>
+        struct SliderTable {
+            std::array<Magic, 64> magics{};
+            std::array<U64, N> attacks{};
+        };
+
+        // Walks the given rays from a square, stopping at the first blocker
+        [[nodiscard]] static constexpr U64 slidingAttacks(int sq, U64 occupied, const int (&directions)[4][2]);
+
         // Slow function to calculate bishop attacks
-        [[nodiscard]] static Bitboard bishopAttacks(Square sq, Bitboard occupied);
+        [[nodiscard]] static constexpr Bitboard bishopAttacks(Square sq, Bitboard occupied);
 
         // Slow function to calculate rook attacks
-        [[nodiscard]] static Bitboard rookAttacks(Square sq, Bitboard occupied);
+        [[nodiscard]] static constexpr Bitboard rookAttacks(Square sq, Bitboard occupied);
 
-        // Initializes the magic bitboard tables for sliding pieces
-        static void initSliders(Square sq, Magic table[], U64 magic,
-                                const std::function<Bitboard(Square, Bitboard)> &attacks);
+        // Builds the magic bitboard table for a sliding piece. Only evaluated at compile time
+        template<std::size_t N>
+        [[nodiscard]] static consteval SliderTable<N> initSliders(const U64 (&magics)[64],
+                                                                  Bitboard (*attacks)(Square, Bitboard));
 
         // clang-format off
     // pre-calculated lookup table for pawn attacks
@@ -837,11 +848,12 @@ namespace chess {
             0x28000010020204ULL, 0x6000020202d0240ULL, 0x8918844842082200ULL, 0x4010011029020020ULL
         };
 
-        static inline Bitboard RookAttacks[0x19000] = {};
-        static inline Bitboard BishopAttacks[0x1480] = {};
+        // Generated at compile time in attacks.cpp, so they live in read-only data and need no startup work
+        static const SliderTable<0x19000> RookTable;
+        static const SliderTable<0x1480> BishopTable;
 
-        static inline Magic RookTable[64] = {};
-        static inline Magic BishopTable[64] = {};
+        friend class movegen;
+        friend class cuckoo;
 
     public:
         static constexpr Bitboard MASK_RANK[8] = {
@@ -885,24 +897,27 @@ namespace chess {
         [[nodiscard]] static Bitboard king(Square sq) noexcept;
 
         [[nodiscard]] static Bitboard attackers(const Board &board, Color color, Square square) noexcept;
-
-        /**
-         * @brief [Internal Usage] Initializes the attacks for the bishop and rook. Called once at startup.
-         */
-        static inline void initAttacks();
     };
 } // namespace chess
 
 #include <array>
 #include <cctype>
+#include <charconv>
 #include <optional>
 
 namespace chess::constants {
     constexpr Bitboard DEFAULT_CHECKMASK = Bitboard(0xFFFFFFFFFFFFFFFFull);
     constexpr auto STARTPOS = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
     constexpr auto MAX_MOVES = 256;
+    // The longest FEN has about 90 characters, so this leaves enough room for any move counters
+    constexpr auto MAX_FEN_LENGTH = 128;
 } // namespace chess::constants
 
+namespace chess {
+    // Caller provided storage for Board::getFen, so writing a FEN never allocates
+    using FenBuffer = std::array<char, constants::MAX_FEN_LENGTH>;
+} // namespace chess
+
 namespace chess {
     class PieceType {
     public:
@@ -1336,9 +1351,20 @@ namespace chess {
                                int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
                                             PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
 
+        /**
+         * @brief Generates pseudo legal moves. Pins and the safety of king moves are not checked,
+         * so every move has to be verified with Board::isLegal before it is made.
+         * When in check only moves that evade the check are generated.
+         */
+        template<MoveGenType mt = MoveGenType::ALL>
+        void static pseudoLegalMoves(Movelist &movelist, const Board &board,
+                                     int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
+                                                  PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
+
     private:
-        static auto init_squares_between();
+        static constexpr auto init_squares_between();
 
+        // Generated at compile time in attacks.cpp
         static const std::array<std::array<Bitboard, 64>, 64> SQUARES_BETWEEN_BB;
 
         // Generate the checkmask. Returns a bitboard where the attacker path between the king and enemy piece is set.
@@ -1386,6 +1412,9 @@ namespace chess {
         template<Color::underlying c, MoveGenType mt>
         static void legalmoves(Movelist &movelist, const Board &board, int pieces);
 
+        template<Color::underlying c, MoveGenType mt>
+        static void pseudoLegalMoves(Movelist &movelist, const Board &board, int pieces);
+
         template<Color::underlying c>
         static bool isEpSquareValid(const Board &board, Square ep);
 
@@ -1603,18 +1632,47 @@ namespace chess {
             return RANDOM_ARRAY[768 + idx];
         }
 
-        [[nodiscard]] static U64 sideToMove() noexcept { return RANDOM_ARRAY[780]; }
+        [[nodiscard]] static constexpr U64 sideToMove() noexcept { return RANDOM_ARRAY[780]; }
 
     public:
         friend class Board;
+        friend class cuckoo;
 
-        [[nodiscard]] static U64 piece(Piece piece, Square square) noexcept {
+        [[nodiscard]] static constexpr U64 piece(Piece piece, Square square) noexcept {
 #if __cplusplus >= 202207L
             [[assume(x < 12)]];
 #endif
             return RANDOM_ARRAY[64 * MAP_HASH_PIECE[piece] + square.index()];
         }
     };
+
+    /**
+     * @brief Cuckoo tables holding the hash difference of every reversible move,
+     * which lets us detect that a position can repeat with the next move in O(1).
+     * Based on "A fast algorithm for detecting upcoming repetitions" by Marcel van Kervinck.
+     */
+    class cuckoo {
+        using U64 = std::uint64_t;
+
+    public:
+        static constexpr int SIZE = 8192;
+
+        struct Table {
+            std::array<U64, SIZE> keys{};
+            std::array<Move, SIZE> moves{};
+        };
+
+        [[nodiscard]] static constexpr int h1(const U64 key) { return static_cast<int>(key & 0x1FFF); }
+
+        [[nodiscard]] static constexpr int h2(const U64 key) { return static_cast<int>((key >> 16) & 0x1FFF); }
+
+        // Generated at compile time in attacks.cpp
+        static const Table TABLE;
+
+    private:
+        // Inserts the key of every non pawn move on an empty board. Only evaluated at compile time
+        [[nodiscard]] static consteval Table init();
+    };
 } // namespace chess
 
 namespace chess {
@@ -1694,14 +1752,16 @@ namespace chess {
             Square enpassant;
             uint8_t half_moves;
             Piece captured_piece;
+            uint16_t plies_from_null;
 
             State(const U64 &hash, const CastlingRights &castling, const Square &enpassant, const uint8_t &half_moves,
-                  const Piece &captured_piece)
+                  const Piece &captured_piece, const uint16_t pliesFromNull)
                 : hash(hash),
                   castling(castling),
                   enpassant(enpassant),
                   half_moves(half_moves),
-                  captured_piece(captured_piece) {
+                  captured_piece(captured_piece),
+                  plies_from_null(pliesFromNull) {
             }
         };
 
@@ -1724,77 +1784,87 @@ namespace chess {
         virtual void setFen(std::string_view fen) { setFenInternal(fen); }
 
         [[nodiscard]] std::string getFen(bool move_counters = true) const {
-            std::string ss;
-            ss.reserve(100);
+            FenBuffer buffer;
+            return std::string(getFen(buffer, move_counters));
+        }
+
+        /**
+         * @brief Writes the FEN into the given buffer without any allocation.
+         * @return View of the FEN, which is only valid as long as the buffer is
+         */
+        std::string_view getFen(FenBuffer &buffer, bool move_counters = true) const {
+            constexpr char PIECE_CHARS[] = "PNBRQKpnbrqk";
+            char *out = buffer.data();
 
             // Loop through the ranks of the board in reverse order
             for (int rank = 7; rank >= 0; rank--) {
-                std::uint32_t free_space = 0;
+                char free_space = 0;
 
-                // Loop through the files of the board
                 for (int file = 0; file < 8; file++) {
-                    // Calculate the square index
-                    const int sq = rank * 8 + file;
-
-                    // If there is a piece at the current square
-                    if (Piece piece = at(Square(sq)); piece != Piece::NONE) {
-                        // If there were any empty squares before this piece,
-                        // append the number of empty squares to the FEN string
-                        if (free_space) {
-                            ss += std::to_string(free_space);
-                            free_space = 0;
-                        }
+                    const Piece piece = board_[rank * 8 + file];
 
-                        // Append the character representing the piece to the FEN string
-                        ss += static_cast<std::string>(piece);
-                    } else {
-                        // If there is no piece at the current square, increment the
-                        // counter for the number of empty squares
+                    // Count the empty squares until we hit the next piece
+                    if (piece == Piece::NONE) {
                         free_space++;
+                        continue;
+                    }
+
+                    if (free_space) {
+                        *out++ = static_cast<char>('0' + free_space);
+                        free_space = 0;
                     }
+
+                    *out++ = PIECE_CHARS[piece];
                 }
 
-                // If there are any empty squares at the end of the rank,
-                // append the number of empty squares to the FEN string
-                if (free_space != 0) {
-                    ss += std::to_string(free_space);
+                if (free_space) {
+                    *out++ = static_cast<char>('0' + free_space);
                 }
 
-                // Append a "/" character to the FEN string, unless this is the last rank
-                ss += (rank > 0 ? "/" : "");
+                if (rank > 0) {
+                    *out++ = '/';
+                }
             }
 
-            // Append " w " or " b " to the FEN string, depending on which player's turn it is
-            ss += ' ';
-            ss += (stm_ == Color::WHITE ? 'w' : 'b');
+            *out++ = ' ';
+            *out++ = stm_ == Color::WHITE ? 'w' : 'b';
+            *out++ = ' ';
 
-            // Append the appropriate characters to the FEN string to indicate
-            // whether castling is allowed for each player
-            if (cr_.isEmpty())
-                ss += " -";
-            else {
-                ss += ' ';
-                ss += getCastleString();
+            if (cr_.isEmpty()) {
+                *out++ = '-';
+            } else {
+                for (const auto color: {Color::WHITE, Color::BLACK}) {
+                    for (const auto side: {CastlingRights::Side::KING_SIDE, CastlingRights::Side::QUEEN_SIDE}) {
+                        if (!cr_.has(color, side))
+                            continue;
+
+                        // Chess960 uses the file of the rook instead of K and Q
+                        const char c = chess960_ ? static_cast<char>('a' + cr_.getRookFile(color, side))
+                                                 : side == CastlingRights::Side::KING_SIDE ? 'k' : 'q';
+                        *out++ = color == Color::WHITE ? static_cast<char>(c - 'a' + 'A') : c;
+                    }
+                }
             }
 
-            // Append information about the en passant square (if any)
-            // and the half-move clock and full move number to the FEN string
-            if (ep_sq_ == Square::underlying::NO_SQ)
-                ss += " -";
-            else {
-                ss += ' ';
-                ss += static_cast<std::string>(ep_sq_);
+            *out++ = ' ';
+
+            if (ep_sq_ == Square::underlying::NO_SQ) {
+                *out++ = '-';
+            } else {
+                *out++ = static_cast<char>('a' + ep_sq_.file());
+                *out++ = static_cast<char>('1' + ep_sq_.rank());
             }
 
             if (move_counters) {
-                ss += ' ';
-                ss += std::to_string(halfMoveClock());
-                ss += ' ';
-                ss += std::to_string(fullMoveNumber());
+                char *end = buffer.data() + buffer.size();
+
+                *out++ = ' ';
+                out = std::to_chars(out, end, halfMoveClock()).ptr;
+                if (out < end) *out++ = ' ';
+                out = std::to_chars(out, end, fullMoveNumber()).ptr;
             }
 
-            // Return the resulting FEN string
-            return ss;
+            return {buffer.data(), static_cast<std::size_t>(out - buffer.data())};
         }
 
         [[nodiscard]] std::string getEpd() const {
@@ -1822,10 +1892,11 @@ namespace chess {
             const auto captured = at(move.to());
             const auto pt = at<PieceType>(move.from());
 
-            prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, captured);
+            prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, captured, plies_from_null_);
 
             hfm_++;
             plies_++;
+            plies_from_null_++;
 
             if (ep_sq_ != Square::underlying::NO_SQ)
                 key_ ^= Zobrist::enpassant(ep_sq_.file());
@@ -1962,6 +2033,7 @@ namespace chess {
             ep_sq_ = prev.enpassant;
             cr_ = prev.castling;
             hfm_ = prev.half_moves;
+            plies_from_null_ = prev.plies_from_null;
             stm_ = ~stm_;
             plies_--;
 
@@ -2018,7 +2090,10 @@ namespace chess {
          * @brief Make a null move. (Switches the side to move)
          */
         void makeNullMove() {
-            prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, Piece::NONE);
+            prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, Piece::NONE, plies_from_null_);
+
+            // Positions before a null move can't be repeated, so the repetition checks stop here
+            plies_from_null_ = 0;
 
             key_ ^= Zobrist::sideToMove();
             if (ep_sq_ != Square::underlying::NO_SQ)
@@ -2039,6 +2114,7 @@ namespace chess {
             ep_sq_ = prev.enpassant;
             cr_ = prev.castling;
             hfm_ = prev.half_moves;
+            plies_from_null_ = prev.plies_from_null;
             key_ = prev.hash;
 
             plies_--;
@@ -2094,6 +2170,23 @@ namespace chess {
         }
 
         [[nodiscard]] U64 hash() const { return key_; }
+
+        // The key after a move, ignoring the castling rights and en passant square the move changes.
+        // This is exact for most moves, which is all a prefetch needs
+        [[nodiscard]] U64 approximateKeyAfter(const Move move) const {
+            const Piece piece = at(move.from());
+            const Piece captured = at(move.to());
+            U64 key = key_ ^ Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to()) ^
+                      Zobrist::sideToMove();
+
+            if (captured != Piece::NONE && move.typeOf() != Move::CASTLING)
+                key ^= Zobrist::piece(captured, move.to());
+
+            if (ep_sq_ != Square::underlying::NO_SQ)
+                key ^= Zobrist::enpassant(ep_sq_.file());
+
+            return key;
+        }
         [[nodiscard]] Color sideToMove() const { return stm_; }
         [[nodiscard]] Square enpassantSq() const { return ep_sq_; }
         [[nodiscard]] CastlingRights castlingRights() const { return cr_; }
@@ -2147,7 +2240,8 @@ namespace chess {
             // be across half-moves.
             const auto size = static_cast<int>(prev_states_.size());
 
-            for (int i = size - 2; i >= 0 && i >= size - hfm_ - 1; i -= 2) {
+            // The position two plies ago can't be the same, since both sides made a move
+            for (int i = size - 4; i >= 0 && i >= size - hfm_ - 1; i -= 2) {
                 if (prev_states_[i].hash == key_)
                     c++;
                 if (c == count)
@@ -2157,6 +2251,49 @@ namespace chess {
             return false;
         }
 
+        /**
+         * @brief Checks if the side to move has a reversible move which leads to a position
+         * that already occurred, i.e. it can force a repetition. Cycles which reach before
+         * the root of the search are ignored, since they would have to be a repetition already.
+         * @param ply distance to the root of the search
+         * @return
+         */
+        [[nodiscard]] bool hasUpcomingRepetition(const int ply) const {
+            const auto size = static_cast<int>(prev_states_.size());
+
+            // A null move isn't reversible, so a cycle can't reach behind the last one
+            const int end = std::min({static_cast<int>(hfm_), static_cast<int>(plies_from_null_), size});
+
+            if (end < 3)
+                return false;
+
+            const Bitboard occupied = occ();
+
+            for (int i = 3; i <= end && i < ply; i += 2) {
+                const U64 move_key = key_ ^ prev_states_[size - i].hash;
+
+                int slot = cuckoo::h1(move_key);
+                if (cuckoo::TABLE.keys[slot] != move_key) {
+                    slot = cuckoo::h2(move_key);
+                    if (cuckoo::TABLE.keys[slot] != move_key)
+                        continue;
+                }
+
+                const Move move = cuckoo::TABLE.moves[slot];
+
+                // The path of the move has to be free
+                if (movegen::SQUARES_BETWEEN_BB[move.from().index()][move.to().index()] & occupied)
+                    continue;
+
+                // The piece that makes the move has to be ours
+                const Square sq = board_[move.from().index()] != Piece::NONE ? move.from() : move.to();
+                if (board_[sq.index()].color() == stm_)
+                    return true;
+            }
+
+            return false;
+        }
+
         /**
          * @brief Checks if the current position is a draw by 50 move rule.
          * Keep in mind that by the rules of chess, if the position has 50 half
@@ -2183,43 +2320,42 @@ namespace chess {
         }
 
         [[nodiscard]] bool isInsufficientMaterial() const {
-            const auto count = occ().count();
-
-            // only kings, draw
-            if (count == 2)
+            // Pawns, rooks and queens can always mate, this already returns for almost every position
+            if (pieceCount(Piece::WHITEPAWN) || pieceCount(Piece::BLACKPAWN) ||
+                pieceCount(Piece::WHITEROOK) || pieceCount(Piece::BLACKROOK) ||
+                pieceCount(Piece::WHITEQUEEN) || pieceCount(Piece::BLACKQUEEN))
+                return false;
+
+            const int white_bishops = pieceCount(Piece::WHITEBISHOP);
+            const int black_bishops = pieceCount(Piece::BLACKBISHOP);
+            const int minors = white_bishops + black_bishops + pieceCount(Piece::WHITEKNIGHT) +
+                               pieceCount(Piece::BLACKKNIGHT);
+
+            // only kings or a single minor piece, cant mate
+            if (minors <= 1)
                 return true;
 
-            // only bishop + knight, cant mate
-            if (count == 3) {
-                if (pieces(PieceType::BISHOP, Color::WHITE) || pieces(PieceType::BISHOP, Color::BLACK))
-                    return true;
-                if (pieces(PieceType::KNIGHT, Color::WHITE) || pieces(PieceType::KNIGHT, Color::BLACK))
-                    return true;
-            }
-
-            // same colored bishops, cant mate
-            if (count == 4) {
-                if (pieces(PieceType::BISHOP, Color::WHITE) && pieces(PieceType::BISHOP, Color::BLACK) &&
-                    Square::same_color(pieces(PieceType::BISHOP, Color::WHITE).lsb(),
-                                       pieces(PieceType::BISHOP, Color::BLACK).lsb()))
-                    return true;
+            if (minors == 2) {
+                // same colored bishops, cant mate
+                if (white_bishops == 1 && black_bishops == 1)
+                    return Square::same_color(pieces(PieceType::BISHOP, Color::WHITE).lsb(),
+                                              pieces(PieceType::BISHOP, Color::BLACK).lsb());
 
                 // one side with two bishops which have the same color
-                auto white_bishops = pieces(PieceType::BISHOP, Color::WHITE);
-                auto black_bishops = pieces(PieceType::BISHOP, Color::BLACK);
-
-                if (white_bishops.count() == 2) {
-                    if (Square::same_color(white_bishops.lsb(), white_bishops.msb()))
-                        return true;
-                } else if (black_bishops.count() == 2) {
-                    if (Square::same_color(black_bishops.lsb(), black_bishops.msb()))
-                        return true;
+                if (white_bishops == 2 || black_bishops == 2) {
+                    const auto bishops = pieces(PieceType::BISHOP);
+                    return Square::same_color(bishops.lsb(), bishops.msb());
                 }
             }
 
             return false;
         }
 
+        /**
+         * @brief Number of pieces of the given kind on the board, maintained incrementally.
+         */
+        [[nodiscard]] int pieceCount(Piece piece) const { return piece_count_[piece]; }
+
         /**
          * @brief Checks if the game is over. Returns GameResultReason::NONE if the game is not over.
          * This function calculates all legal moves for the current position to check if the game is over.
@@ -2246,7 +2382,12 @@ namespace chess {
             return {GameResultReason::NONE, GameResult::NONE};
         }
 
-        [[nodiscard]] bool isAttacked(Square square, Color color) const {
+        [[nodiscard]] bool isAttacked(Square square, Color color) const { return isAttacked(square, color, occ()); }
+
+        /**
+         * @brief Checks if a square is attacked by the color, with sliders using the given occupancy.
+         */
+        [[nodiscard]] bool isAttacked(Square square, Color color, Bitboard occupied) const {
             // cheap checks first
             if (attacks::pawn(~color, square) & pieces(PieceType::PAWN, color))
                 return true;
@@ -2255,10 +2396,10 @@ namespace chess {
             if (attacks::king(square) & pieces(PieceType::KING, color))
                 return true;
 
-            if (attacks::bishop(square, occ()) & (pieces(PieceType::BISHOP, color) | pieces(PieceType::QUEEN, color)))
+            if (attacks::bishop(square, occupied) & (pieces(PieceType::BISHOP, color) | pieces(PieceType::QUEEN, color)))
                 return true;
 
-            if (attacks::rook(square, occ()) & (pieces(PieceType::ROOK, color) | pieces(PieceType::QUEEN, color)))
+            if (attacks::rook(square, occupied) & (pieces(PieceType::ROOK, color) | pieces(PieceType::QUEEN, color)))
                 return true;
 
             return false;
@@ -2266,6 +2407,158 @@ namespace chess {
 
         [[nodiscard]] bool inCheck() const { return isAttacked(kingSq(stm_), ~stm_); }
 
+        /**
+         * @brief Checks if a pseudo legal move leaves our king safe. The move has to come from
+         * movegen::pseudoLegalMoves or pass isPseudoLegal, otherwise the result is undefined.
+         */
+        [[nodiscard]] bool isLegal(const Move move) const {
+            const Square king_sq = kingSq(stm_);
+            const Bitboard from_bb = Bitboard::fromSquare(move.from());
+            const Bitboard to_bb = Bitboard::fromSquare(move.to());
+
+            if (move.typeOf() == Move::CASTLING) {
+                // Chess960 castling has too many special cases, so we compare it against the legal king moves
+                if (chess960_) {
+                    Movelist moves;
+                    movegen::legalmoves(moves, *this, PieceGenType::KING);
+                    return std::find(moves.begin(), moves.end(), move) != moves.end();
+                }
+
+                // The generator already made sure that we aren't in check and that the path is empty,
+                // so the king only must not pass or land on an attacked square
+                const Square king_to = Square::castling_king_square(move.to() > move.from(), stm_);
+                Bitboard path = movegen::SQUARES_BETWEEN_BB[king_sq.index()][king_to.index()] |
+                                Bitboard::fromSquare(king_to);
+
+                while (path) {
+                    if (isAttacked(path.pop(), ~stm_))
+                        return false;
+                }
+
+                return true;
+            }
+
+            // The king must not walk into an attack. Sliders can see through the king's old square
+            if (move.from() == king_sq) {
+                return !isAttacked(move.to(), ~stm_, occ() ^ from_bb);
+            }
+
+            Bitboard captured = to_bb;
+            Bitboard occupied = (occ() ^ from_bb) | to_bb;
+
+            if (move.typeOf() == Move::ENPASSANT) {
+                captured = Bitboard::fromSquare(move.to().ep_square());
+                occupied ^= captured;
+            } else if (!(attacks::queen(king_sq, 0ULL) & from_bb)) {
+                // Evasions are already handled by the generator, so only a piece that
+                // stands on a line with our king can uncover an attack
+                return true;
+            }
+
+            const Bitboard queens = pieces(PieceType::QUEEN, ~stm_);
+            const Bitboard bishops = (pieces(PieceType::BISHOP, ~stm_) | queens) & ~captured;
+            const Bitboard rooks = (pieces(PieceType::ROOK, ~stm_) | queens) & ~captured;
+
+            return !(attacks::bishop(king_sq, occupied) & bishops) && !(attacks::rook(king_sq, occupied) & rooks);
+        }
+
+        /**
+         * @brief Checks if a move could have been generated by movegen::pseudoLegalMoves in this
+         * position. Useful to validate moves from the transposition table or killer moves
+         * before any moves are generated.
+         */
+        [[nodiscard]] bool isPseudoLegal(const Move move) const {
+            if (move == Move::NO_MOVE || move == Move::NULL_MOVE)
+                return false;
+
+            const Square from = move.from();
+            const Square to = move.to();
+            const Piece piece = at(from);
+
+            if (piece == Piece::NONE || piece.color() != stm_)
+                return false;
+
+            // The generator never sets the promotion bits for other move types
+            if (move.typeOf() != Move::PROMOTION && move.promotionType() != PieceType::KNIGHT)
+                return false;
+
+            // Castling and en passant are rare, so we compare them against the generator
+            if (move.typeOf() == Move::CASTLING || move.typeOf() == Move::ENPASSANT) {
+                if (piece.type() != (move.typeOf() == Move::CASTLING ? PieceType::KING : PieceType::PAWN))
+                    return false;
+
+                Movelist moves;
+                movegen::pseudoLegalMoves(moves, *this,
+                                          move.typeOf() == Move::CASTLING ? PieceGenType::KING : PieceGenType::PAWN);
+                return std::find(moves.begin(), moves.end(), move) != moves.end();
+            }
+
+            const Bitboard to_bb = Bitboard::fromSquare(to);
+
+            if (us(stm_) & to_bb)
+                return false;
+
+            Bitboard targets;
+
+            if (piece.type() == PieceType::PAWN) {
+                // Pawns have to promote when they reach the last rank, no other piece can promote
+                if ((move.typeOf() == Move::PROMOTION) != Square::back_rank(to, ~stm_))
+                    return false;
+
+                const int up = stm_ == Color::WHITE ? 8 : -8;
+                const Bitboard single_push = Bitboard::fromSquare(from.index() + up) & ~occ();
+                const bool on_start_rank = from.rank() == Rank::rank(Rank::RANK_2, stm_);
+
+                targets = attacks::pawn(stm_, from) & them(stm_);
+                targets |= single_push;
+
+                if (single_push && on_start_rank) {
+                    targets |= Bitboard::fromSquare(from.index() + 2 * up) & ~occ();
+                }
+            } else {
+                if (move.typeOf() == Move::PROMOTION)
+                    return false;
+
+                switch (static_cast<int>(piece.type())) {
+                    case static_cast<int>(PieceType::KNIGHT):
+                        targets = attacks::knight(from);
+                        break;
+                    case static_cast<int>(PieceType::BISHOP):
+                        targets = attacks::bishop(from, occ());
+                        break;
+                    case static_cast<int>(PieceType::ROOK):
+                        targets = attacks::rook(from, occ());
+                        break;
+                    case static_cast<int>(PieceType::QUEEN):
+                        targets = attacks::queen(from, occ());
+                        break;
+                    default:
+                        targets = attacks::king(from);
+                        break;
+                }
+            }
+
+            if (!(targets & to_bb))
+                return false;
+
+            // In check the generator only creates king moves and moves that capture or block the checker
+            if (piece.type() != PieceType::KING) {
+                const Square king_sq = kingSq(stm_);
+                const Bitboard checkers = attacks::attackers(*this, ~stm_, king_sq);
+
+                if (checkers) {
+                    if (checkers.count() > 1)
+                        return false;
+
+                    const int checker = checkers.lsb();
+                    if (!((movegen::SQUARES_BETWEEN_BB[king_sq.index()][checker] | checkers) & to_bb))
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
         [[nodiscard]] bool hasNonPawnMaterial(Color color) const {
             return bool(pieces(PieceType::KNIGHT, color) | pieces(PieceType::BISHOP, color) |
                         pieces(PieceType::ROOK, color) | pieces(PieceType::QUEEN, color));
@@ -2313,6 +2606,7 @@ namespace chess {
         std::array<Bitboard, 6> pieces_bb_ = {};
         std::array<Bitboard, 2> occ_bb_ = {};
         std::array<Piece, 64> board_ = {};
+        std::array<std::uint8_t, 12> piece_count_ = {};
 
         U64 key_ = 0ULL;
         CastlingRights cr_ = {};
@@ -2320,6 +2614,7 @@ namespace chess {
         Color stm_ = Color::WHITE;
         Square ep_sq_ = Square::underlying::NO_SQ;
         uint8_t hfm_ = 0;
+        uint16_t plies_from_null_ = 0;
 
         bool chess960_ = false;
 
@@ -2334,8 +2629,11 @@ namespace chess {
             pieces_bb_[type].clear(index);
             occ_bb_[color].clear(index);
             board_[index] = Piece::NONE;
+            piece_count_[piece]--;
 
-            net->updateAccumulator(type, color, sq.index(), false);
+            // Boards without a network (e.g. for perft) skip the accumulator
+            if (net)
+                net->updateAccumulator(type, color, sq.index(), false);
         }
 
         void placePieceInternal(Piece piece, Square sq) {
@@ -2346,18 +2644,22 @@ namespace chess {
             pieces_bb_[type].set(index);
             occ_bb_[color].set(index);
             board_[index] = piece;
-            net->updateAccumulator((int) type, (int) color, sq.index(), true);
+            piece_count_[piece]++;
+            if (net)
+                net->updateAccumulator((int) type, (int) color, sq.index(), true);
         }
 
         template<bool ctor = false>
         void setFenInternal(std::string_view fen) {
             original_fen_ = fen;
 
-            net->refreshAccumulator();
+            if (net)
+                net->refreshAccumulator();
 
             occ_bb_.fill(0ULL);
             pieces_bb_.fill(0ULL);
             board_.fill(Piece::NONE);
+            piece_count_.fill(0);
 
             // find leading whitespaces and remove them
             while (fen[0] == ' ')
@@ -2375,9 +2677,10 @@ namespace chess {
                 if (!sv.empty() && sv.back() == ';')
                     sv.remove_suffix(1);
 
-                size_t pos;
-                int value = std::stoi(std::string(sv), &pos);
-                if (pos == sv.size())
+                // from_chars parses the view in place, so there is no temporary string
+                int value = 0;
+                const auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+                if (ec == std::errc() && ptr == sv.data() + sv.size())
                     return value;
 
                 return std::nullopt;
@@ -2385,6 +2688,7 @@ namespace chess {
 
             // Half move clock
             hfm_ = parseStringViewToInt(half_move).value_or(0);
+            plies_from_null_ = 0;
 
             // Full move number
             plies_ = parseStringViewToInt(full_move).value_or(1);
@@ -2605,11 +2909,13 @@ namespace chess {
     [[nodiscard]] inline Bitboard attacks::knight(Square sq) noexcept { return KnightAttacks[sq.index()]; }
 
     [[nodiscard]] inline Bitboard attacks::bishop(Square sq, Bitboard occupied) noexcept {
-        return BishopTable[sq.index()].attacks[BishopTable[sq.index()](occupied)];
+        const Magic &magic = BishopTable.magics[sq.index()];
+        return BishopTable.attacks[magic.offset + magic(occupied)];
     }
 
     [[nodiscard]] inline Bitboard attacks::rook(Square sq, Bitboard occupied) noexcept {
-        return RookTable[sq.index()].attacks[RookTable[sq.index()](occupied)];
+        const Magic &magic = RookTable.magics[sq.index()];
+        return RookTable.attacks[magic.offset + magic(occupied)];
     }
 
     [[nodiscard]] inline Bitboard attacks::queen(Square sq, Bitboard occupied) noexcept {
@@ -2632,122 +2938,125 @@ namespace chess {
         return atks & occupied;
     }
 
-    [[nodiscard]] inline Bitboard attacks::bishopAttacks(Square sq, Bitboard occupied) {
-        Bitboard attacks = 0ULL;
-
-        int r, f;
-
-        int br = sq.rank();
-        int bf = sq.file();
+    [[nodiscard]] inline constexpr attacks::U64 attacks::slidingAttacks(const int sq, const U64 occupied,
+                                                                        const int (&directions)[4][2]) {
+        U64 attacks = 0ULL;
 
-        for (r = br + 1, f = bf + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r++, f++) {
-            auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
-        }
-
-        for (r = br - 1, f = bf + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r--, f++) {
-            auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
+        // Walk along every ray until we leave the board or hit a piece
+        for (const auto &[dr, df]: directions) {
+            for (int r = (sq >> 3) + dr, f = (sq & 7) + df; r >= 0 && r < 8 && f >= 0 && f < 8; r += dr, f += df) {
+                const U64 bit = 1ULL << (r * 8 + f);
+                attacks |= bit;
+                if (occupied & bit)
+                    break;
+            }
         }
 
-        for (r = br + 1, f = bf - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r++, f--) {
-            auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
-        }
+        return attacks;
+    }
 
-        for (r = br - 1, f = bf - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r--, f--) {
-            auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
-        }
+    [[nodiscard]] inline constexpr Bitboard attacks::bishopAttacks(Square sq, Bitboard occupied) {
+        constexpr int directions[4][2] = {{1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+        return slidingAttacks(sq.index(), occupied.getBits(), directions);
+    }
 
-        return attacks;
+    [[nodiscard]] inline constexpr Bitboard attacks::rookAttacks(Square sq, Bitboard occupied) {
+        constexpr int directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        return slidingAttacks(sq.index(), occupied.getBits(), directions);
     }
 
-    [[nodiscard]] inline Bitboard attacks::rookAttacks(Square sq, Bitboard occupied) {
-        Bitboard attacks = 0ULL;
+    template<std::size_t N>
+    inline consteval attacks::SliderTable<N> attacks::initSliders(const U64 (&magics)[64],
+                                                                  Bitboard (*attacks)(Square, Bitboard)) {
+        SliderTable<N> table{};
+        std::uint32_t offset = 0;
 
-        int r, f;
+        for (int i = 0; i < 64; i++) {
+            const Square sq = i;
 
-        int rr = sq.rank();
-        int rf = sq.file();
+            // The edges of the board are not considered for the attacks
+            // i.e. for the sq h7 edges will be a1-h1, a1-a8, a8-h8, ignoring the edge of the current square
+            const Bitboard edges = ((Bitboard(Rank::RANK_1) | Bitboard(Rank::RANK_8)) & ~Bitboard(sq.rank())) |
+                                   ((Bitboard(File::FILE_A) | Bitboard(File::FILE_H)) & ~Bitboard(sq.file()));
 
-        for (r = rr + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(rf)); r++) {
-            auto s = Square(static_cast<Rank>(r), static_cast<File>(rf)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
-        }
+            auto &table_sq = table.magics[i];
 
-        for (r = rr - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(rf)); r--) {
-            auto s = Square(static_cast<Rank>(r), static_cast<File>(rf)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
-        }
+            table_sq.magic = magics[i];
+            table_sq.mask = (attacks(sq, 0ULL) & ~edges).getBits();
+            table_sq.shift = 64 - Bitboard(table_sq.mask).count();
+            table_sq.offset = offset;
 
-        for (f = rf + 1; Square::is_valid(static_cast<Rank>(rr), static_cast<File>(f)); f++) {
-            auto s = Square(static_cast<Rank>(rr), static_cast<File>(f)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
-        }
+            // Walk every subset of the mask (Carry-Rippler)
+            U64 occ = 0ULL;
+            do {
+                table.attacks[offset + table_sq(occ)] = attacks(sq, occ).getBits();
+                occ = (occ - table_sq.mask) & table_sq.mask;
+            } while (occ);
 
-        for (f = rf - 1; Square::is_valid(static_cast<Rank>(rr), static_cast<File>(f)); f--) {
-            auto s = Square(static_cast<Rank>(rr), static_cast<File>(f)).index();
-            attacks.set(s);
-            if (occupied.check(s))
-                break;
+            offset += 1u << Bitboard(table_sq.mask).count();
         }
 
-        return attacks;
+        return table;
     }
 
-    inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
-                                     const std::function<Bitboard(Square, Bitboard)> &attacks) {
-        // The edges of the board are not considered for the attacks
-        // i.e. for the sq h7 edges will be a1-h1, a1-a8, a8-h8, ignoring the edge of the current square
-        const Bitboard edges = ((Bitboard(Rank::RANK_1) | Bitboard(Rank::RANK_8)) & ~Bitboard(sq.rank())) |
-                               ((Bitboard(File::FILE_A) | Bitboard(File::FILE_H)) & ~Bitboard(sq.file()));
+    inline consteval cuckoo::Table cuckoo::init() {
+        Table table{};
+
+        for (int p = 0; p < 12; p++) {
+            const Piece piece = static_cast<Piece::underlying>(p);
 
-        U64 occ = 0ULL;
+            // Pawn moves are never reversible
+            if (piece.type() == PieceType::PAWN)
+                continue;
 
-        auto &table_sq = table[sq.index()];
+            for (int s1 = 0; s1 < 64; s1++) {
+                for (int s2 = s1 + 1; s2 < 64; s2++) {
+                    U64 targets = 0ULL;
+                    switch (static_cast<int>(piece.type())) {
+                        case static_cast<int>(PieceType::KNIGHT):
+                            targets = attacks::KnightAttacks[s1].getBits();
+                            break;
+                        case static_cast<int>(PieceType::BISHOP):
+                            targets = attacks::bishopAttacks(s1, 0ULL).getBits();
+                            break;
+                        case static_cast<int>(PieceType::ROOK):
+                            targets = attacks::rookAttacks(s1, 0ULL).getBits();
+                            break;
+                        case static_cast<int>(PieceType::QUEEN):
+                            targets = (attacks::bishopAttacks(s1, 0ULL) | attacks::rookAttacks(s1, 0ULL)).getBits();
+                            break;
+                        default:
+                            targets = attacks::KingAttacks[s1].getBits();
+                            break;
+                    }
 
-        table_sq.magic = magic;
-        table_sq.mask = (attacks(sq, occ) & ~edges).getBits();
-        table_sq.shift = 64 - Bitboard(table_sq.mask).count();
+                    if (!(targets & (1ULL << s2)))
+                        continue;
 
-        if (sq < 64 - 1) {
-            table[sq.index() + 1].attacks = table_sq.attacks + (1ull << Bitboard(table_sq.mask).count());
-        }
+                    U64 key = Zobrist::piece(piece, s1) ^ Zobrist::piece(piece, s2) ^ Zobrist::sideToMove();
+                    Move move = Move::make(s1, s2);
 
-        do {
-            table_sq.attacks[table_sq(occ)] = attacks(sq, occ);
-            occ = (occ - table_sq.mask) & table_sq.mask;
-        } while (occ);
-    }
+                    // Cuckoo insertion, kick out the present entry until we find an empty slot
+                    int i = h1(key);
+                    while (true) {
+                        std::swap(table.keys[i], key);
+                        std::swap(table.moves[i], move);
 
-    inline void attacks::initAttacks() {
-        BishopTable[0].attacks = BishopAttacks;
-        RookTable[0].attacks = RookAttacks;
+                        if (move == Move::NO_MOVE)
+                            break;
 
-        for (int i = 0; i < 64; i++) {
-            initSliders(static_cast<Square>(i), BishopTable, BishopMagics[i], bishopAttacks);
-            initSliders(static_cast<Square>(i), RookTable, RookMagics[i], rookAttacks);
+                        i = i == h1(key) ? h2(key) : h1(key);
+                    }
+                }
+            }
         }
+
+        return table;
     }
 } // namespace chess
 
 namespace chess {
-    inline auto movegen::init_squares_between() {
+    inline constexpr auto movegen::init_squares_between() {
         std::array<std::array<Bitboard, 64>, 64> squares_between_bb{};
         Bitboard sqs = 0;
 
@@ -2757,10 +3066,11 @@ namespace chess {
                 if (sq1 == sq2)
                     squares_between_bb[sq1.index()][sq2.index()].clear();
                 else if (sq1.file() == sq2.file() || sq1.rank() == sq2.rank())
-                    squares_between_bb[sq1.index()][sq2.index()] = attacks::rook(sq1, sqs) & attacks::rook(sq2, sqs);
+                    squares_between_bb[sq1.index()][sq2.index()] =
+                            attacks::rookAttacks(sq1, sqs) & attacks::rookAttacks(sq2, sqs);
                 else if (sq1.diagonal_of() == sq2.diagonal_of() || sq1.antidiagonal_of() == sq2.antidiagonal_of())
                     squares_between_bb[sq1.index()][sq2.index()] =
-                            attacks::bishop(sq1, sqs) & attacks::bishop(sq2, sqs);
+                            attacks::bishopAttacks(sq1, sqs) & attacks::bishopAttacks(sq2, sqs);
             }
         }
 
@@ -3268,6 +3578,82 @@ namespace chess {
             legalmoves<Color::BLACK, mt>(movelist, board, pieces);
     }
 
+    template<Color::underlying c, movegen::MoveGenType mt>
+    inline void movegen::pseudoLegalMoves(Movelist &movelist, const Board &board, int pieces) {
+        const auto king_sq = board.kingSq(c);
+
+        const Bitboard occ_us = board.us(c);
+        const Bitboard occ_opp = board.us(~c);
+        const Bitboard occ_all = occ_us | occ_opp;
+
+        // Evasions are still generated here, because it is cheap and lets Board::isLegal
+        // only look at sliders that get uncovered by the move
+        const auto [checkmask, checks] = checkMask<c>(board, king_sq);
+
+        Bitboard movable_square;
+
+        if (mt == MoveGenType::ALL)
+            movable_square = ~occ_us;
+        else if (mt == MoveGenType::CAPTURE)
+            movable_square = occ_opp;
+        else // QUIET moves
+            movable_square = ~occ_all;
+
+        if (pieces & PieceGenType::KING) {
+            whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq),
+                             [&](Square sq) { return attacks::king(sq) & movable_square; });
+
+            if (checks == 0) {
+                // Without any seen squares this only checks that the path is free
+                Bitboard moves_bb = generateCastleMoves<c, mt>(board, king_sq, 0ULL, 0ULL);
+
+                while (moves_bb) {
+                    Square to = moves_bb.pop();
+                    movelist.add(Move::make<Move::CASTLING>(king_sq, to));
+                }
+            }
+        }
+
+        movable_square &= checkmask;
+
+        if (checks == 2)
+            return;
+
+        if (pieces & PieceGenType::PAWN) {
+            generatePawnMoves<c, mt>(board, movelist, 0ULL, 0ULL, checkmask, occ_opp);
+        }
+
+        if (pieces & PieceGenType::KNIGHT) {
+            whileBitboardAdd(movelist, board.pieces(PieceType::KNIGHT, c),
+                             [&](Square sq) { return attacks::knight(sq) & movable_square; });
+        }
+
+        if (pieces & PieceGenType::BISHOP) {
+            whileBitboardAdd(movelist, board.pieces(PieceType::BISHOP, c),
+                             [&](Square sq) { return attacks::bishop(sq, occ_all) & movable_square; });
+        }
+
+        if (pieces & PieceGenType::ROOK) {
+            whileBitboardAdd(movelist, board.pieces(PieceType::ROOK, c),
+                             [&](Square sq) { return attacks::rook(sq, occ_all) & movable_square; });
+        }
+
+        if (pieces & PieceGenType::QUEEN) {
+            whileBitboardAdd(movelist, board.pieces(PieceType::QUEEN, c),
+                             [&](Square sq) { return attacks::queen(sq, occ_all) & movable_square; });
+        }
+    }
+
+    template<movegen::MoveGenType mt>
+    inline void movegen::pseudoLegalMoves(Movelist &movelist, const Board &board, int pieces) {
+        movelist.clear();
+
+        if (board.sideToMove() == Color::WHITE)
+            pseudoLegalMoves<Color::WHITE, mt>(movelist, board, pieces);
+        else
+            pseudoLegalMoves<Color::BLACK, mt>(movelist, board, pieces);
+    }
+
     template<Color::underlying c>
     inline bool movegen::isEpSquareValid(const Board &board, Square ep) {
         const auto stm = board.sideToMove();
@@ -3295,10 +3681,6 @@ namespace chess {
         return found;
     }
 
-    inline const std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB = [] {
-        attacks::initAttacks();
-        return movegen::init_squares_between();
-    }();
 } // namespace chess
 
 #include <sstream>
@@ -3331,7 +3713,7 @@ namespace chess {
             return ss.str();
         }
 
-        [[nodiscard]] static Move uciToMove(const Board &board, const std::string &uci) noexcept(false) {
+        [[nodiscard]] static Move uciToMove(const Board &board, std::string_view uci) noexcept(false) {
             if (uci.length() < 4) {
                 return Move::NO_MOVE;
             }
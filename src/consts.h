@@ -28,12 +28,6 @@ const std::string STARTPOS = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq
 // Bench depth
 constexpr int benchDepth = 14;
 
-constexpr int hashMoveScore = 500000;
-constexpr int killerScore = 300000;
-constexpr int promotion = 200000;
-constexpr int goodCapture = 400000;
-constexpr int badCapture = -500000;
-
 enum Bound : std::uint8_t {
     EXACT = 0,
     UPPER = 1,
@@ -44,7 +38,8 @@ enum Bound : std::uint8_t {
 constexpr int CORRHIST_LIMIT = 1024;
 
 constexpr int MAX_PLY = 246;
-constexpr int MAX_MOVES = 218;
+// Pseudo legal move lists can be longer than the 218 legal moves a position can have at most
+constexpr int MAX_MOVES = 256;
 
 constexpr int EVAL_MATE = 30000;
 constexpr int EVAL_INFINITE = 31000;
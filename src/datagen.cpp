@@ -23,42 +23,403 @@
 #include "see.h"
 #include "timeman.h"
 #include "NNUE/nnue.h"
+#include "gamerecord.h"
 #include <random>
 #include <string>
-#include <vector>
-#include <mutex>
 #include <atomic>
 #include <cassert>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <limits>
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <sstream>
+
+// The only state shared by the datagen threads
+std::atomic<std::uint64_t> totalPositionsGenerated(0);
+std::atomic<std::uint64_t> totalDuplicates(0);
+std::atomic<int> runningThreads(0);
+
+// Every thread writes to its own shard, so no thread ever waits for a lock
+constexpr std::size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+// A shard is flushed and checkpointed at least this often, so an interruption loses at most this much work
+constexpr auto CHECKPOINT_INTERVAL = std::chrono::seconds(60);
+
+// Marks a manifest whose run has not reached the merge step yet
+constexpr std::uint64_t NO_MERGE = std::numeric_limits<std::uint64_t>::max();
+
+// The committed state of a shard, everything behind 'bytes' is discarded when resuming
+struct ShardCheckpoint {
+    std::uint64_t games = 0;
+    std::uint64_t positions = 0;
+    std::uint64_t bytes = 0;
+};
+
+static std::string shardFile(const std::string &outputPath, const int threadId) {
+    return outputPath + ".shard" + std::to_string(threadId);
+}
+
+static std::string checkpointFile(const std::string &outputPath, const int threadId) {
+    return shardFile(outputPath, threadId) + ".checkpoint";
+}
+
+static std::string manifestFile(const std::string &outputPath) {
+    return outputPath + ".datagen";
+}
+
+// Writes to a temporary file first, the rename replaces the old file atomically
+static void writeFileAtomic(const std::string &path, const std::string &content) {
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << content;
+    }
+    std::filesystem::rename(tmpPath, path);
+}
+
+static ShardCheckpoint readCheckpoint(const std::string &path) {
+    ShardCheckpoint checkpoint;
+    std::ifstream file(path);
+    std::string key;
+    while (file >> key) {
+        if (key == "games") file >> checkpoint.games;
+        else if (key == "positions") file >> checkpoint.positions;
+        else if (key == "bytes") file >> checkpoint.bytes;
+    }
+    return file.eof() ? checkpoint : ShardCheckpoint{};
+}
+
+static void writeCheckpoint(const std::string &path, const ShardCheckpoint &checkpoint) {
+    writeFileAtomic(path, "games " + std::to_string(checkpoint.games) +
+                          " positions " + std::to_string(checkpoint.positions) +
+                          " bytes " + std::to_string(checkpoint.bytes) + "\n");
+}
+
+// The settings of a run in the option syntax, the output path is implied by the manifest's location
+static std::string formatOptions(const DatagenConfig &config) {
+    return "threads=" + std::to_string(config.threads) +
+           " positions=" + std::to_string(config.positions) +
+           " seed=" + std::to_string(config.seed) +
+           " win_plies=" + std::to_string(config.winPlies) +
+           " win_score=" + std::to_string(config.winScore) +
+           " draw_ply=" + std::to_string(config.drawPly) +
+           " draw_plies=" + std::to_string(config.drawPlies) +
+           " draw_score=" + std::to_string(config.drawScore) +
+           " material_draw=" + std::to_string(config.materialDraw) +
+           (config.bookPath.empty() ? "" : " book=" + config.bookPath) +
+           " random_plies=" + std::to_string(config.randomPlies) +
+           " opening_score=" + std::to_string(config.openingScore) +
+           " opening_nodes=" + std::to_string(config.openingNodes) +
+           " hash_mb=" + std::to_string(config.hashMB) +
+           " dedup_mb=" + std::to_string(config.dedupMB);
+}
+
+static bool readManifest(const std::string &path, DatagenConfig &config, std::uint64_t &mergeOffset, bool &merged) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string options;
+    std::getline(file, options);
+    std::istringstream is(options);
+    parseDatagenOptions(is, config);
+
+    std::string key;
+    mergeOffset = NO_MERGE;
+    merged = false;
+    if (file >> key && key == "merge") {
+        file >> mergeOffset;
+        merged = file >> key && key == "merged";
+    }
+    return true;
+}
+
+// A merged run only has its leftover shards and checkpoints to remove
+static void writeManifest(const std::string &path, const DatagenConfig &config, const std::uint64_t mergeOffset,
+                          const bool merged = false) {
+    std::string content = formatOptions(config) + "\n";
+    if (mergeOffset != NO_MERGE) {
+        content += "merge " + std::to_string(mergeOffset) + "\n";
+        if (merged) {
+            content += "merged\n";
+        }
+    }
+    writeFileAtomic(path, content);
+}
+
+// Lone rooks and minor pieces against each other are practically always drawn, while a rook or
+// minor piece against a bare king is already covered by the insufficient material rule or is a win
+static bool isMaterialDraw(const Board &board) {
+    if (board.pieces(PieceType::PAWN).count() || board.pieces(PieceType::QUEEN).count()) {
+        return false;
+    }
+
+    return board.us(Color::WHITE).count() == 2 && board.us(Color::BLACK).count() == 2;
+}
+
+// Ends games early once their outcome is clear, the scores are from white's point of view
+class Adjudicator {
+public:
+    explicit Adjudicator(const DatagenConfig &settings) : config(settings) {
+    }
+
+    void reset() {
+        winStreak = 0;
+        drawStreak = 0;
+    }
+
+    // Returns true and sets the result once the game can be adjudicated
+    bool update(const int ply, const int whiteScore, GameResult8 &result) {
+        // A streak only counts while the same side stays ahead
+        if (whiteScore >= config.winScore) {
+            winStreak = std::max(winStreak, 0) + 1;
+        } else if (whiteScore <= -config.winScore) {
+            winStreak = std::min(winStreak, 0) - 1;
+        } else {
+            winStreak = 0;
+        }
+
+        drawStreak = std::abs(whiteScore) <= config.drawScore ? drawStreak + 1 : 0;
+
+        if (config.winPlies > 0 && std::abs(winStreak) >= config.winPlies) {
+            result = winStreak > 0 ? GameResult8::WHITE_WIN : GameResult8::BLACK_WIN;
+            return true;
+        }
+
+        if (config.drawPlies > 0 && ply >= config.drawPly && drawStreak >= config.drawPlies) {
+            result = GameResult8::DRAW;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    const DatagenConfig &config;
+    int winStreak = 0;
+    int drawStreak = 0;
+};
+
+static std::uint64_t splitMix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Every game gets its own seed, so it can be replayed without the games before it
+static std::uint64_t gameSeed(const std::uint64_t seed, const int threadId, const std::uint64_t gameIndex) {
+    return splitMix64(splitMix64(splitMix64(seed) ^ static_cast<std::uint64_t>(threadId)) ^ gameIndex);
+}
+
+// A Bloom filter of Zobrist keys shared by all threads. A false positive only drops a unique
+// position, and two threads that write the same position at the same time may both keep it
+class DuplicateFilter {
+public:
+    void resize(const std::uint64_t MB) {
+        size = MB ? std::bit_floor((MB << 20) / sizeof(std::uint64_t)) : 0;
+        words = size ? std::make_unique<std::atomic<std::uint64_t>[]>(size) : nullptr;
+    }
+
+    [[nodiscard]] bool isEnabled() const {
+        return size != 0;
+    }
+
+    [[nodiscard]] std::uint64_t memoryUsage() const {
+        return size * sizeof(std::uint64_t);
+    }
+
+    // Marks the key as seen, returns true if it was seen before
+    bool insert(const std::uint64_t key) {
+        // Double hashing, the key itself is already uniformly distributed
+        const std::uint64_t step = splitMix64(key) | 1;
+        const std::uint64_t bitMask = size * 64 - 1;
+        bool seen = true;
+
+        for (std::uint64_t i = 0; i < HASHES; i++) {
+            const std::uint64_t bit = (key + i * step) & bitMask;
+            const std::uint64_t mask = 1ULL << (bit & 63);
+            seen &= (words[bit >> 6].fetch_or(mask, std::memory_order_relaxed) & mask) != 0;
+        }
+
+        return seen;
+    }
+
+private:
+    static constexpr std::uint64_t HASHES = 4;
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> words;
+    std::uint64_t size = 0;
+};
+
+DuplicateFilter duplicateFilter;
+
+// Cuts a shard back to its last checkpoint, so the games behind it can be replayed
+static void restoreShard(const DatagenConfig &config, const int threadId) {
+    const std::string shardPath = shardFile(config.outputPath, threadId);
+    const std::string checkpointPath = checkpointFile(config.outputPath, threadId);
+    const ShardCheckpoint checkpoint = readCheckpoint(checkpointPath);
+
+    if (!std::filesystem::exists(shardPath) || std::filesystem::file_size(shardPath) < checkpoint.bytes) {
+        std::filesystem::remove(shardPath);
+        std::filesystem::remove(checkpointPath);
+        return;
+    }
+
+    std::filesystem::resize_file(shardPath, checkpoint.bytes);
+
+    // The positions that were already written must stay duplicates after resuming
+    if (duplicateFilter.isEnabled()) {
+        GameReader reader(shardPath);
+        Board board;
+        while (reader.nextGame()) {
+            reader.forEachPosition(board, [](const Board &position, int, GameResult8) {
+                duplicateFilter.insert(position.hash());
+            });
+        }
+    }
+}
+
+bool parseDatagenOptions(std::istringstream &is, DatagenConfig &config) {
+    bool hasOptions = false;
+    bool hasSeed = false;
+    std::string token;
+
+    while (is >> token) {
+        const std::size_t separator = token.find('=');
+        if (separator == std::string::npos) {
+            std::cerr << "Invalid datagen option: '" << token << "'!" << std::endl;
+            continue;
+        }
 
-// Global resources shared across all threads
-extern std::mutex outputFileMutex;
-extern std::atomic<std::uint64_t> totalPositionsGenerated;
+        const std::string key = token.substr(0, separator);
+        const std::string value = token.substr(separator + 1);
+        hasOptions = true;
 
-void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmount) {
-    tt transpositionTable(16);
+        try {
+            if (key == "threads") {
+                config.threads = std::max(1, std::stoi(value));
+            } else if (key == "positions") {
+                config.positions = std::stoull(value);
+            } else if (key == "seed") {
+                config.seed = std::stoull(value);
+                hasSeed = true;
+            } else if (key == "out") {
+                config.outputPath = value;
+            } else if (key == "win_plies") {
+                config.winPlies = std::max(0, std::stoi(value));
+            } else if (key == "win_score") {
+                config.winScore = std::stoi(value);
+            } else if (key == "draw_ply") {
+                config.drawPly = std::max(0, std::stoi(value));
+            } else if (key == "draw_plies") {
+                config.drawPlies = std::max(0, std::stoi(value));
+            } else if (key == "draw_score") {
+                config.drawScore = std::stoi(value);
+            } else if (key == "material_draw") {
+                config.materialDraw = std::stoi(value) != 0;
+            } else if (key == "book") {
+                config.bookPath = value;
+            } else if (key == "random_plies") {
+                config.randomPlies = std::max(0, std::stoi(value));
+            } else if (key == "opening_score") {
+                config.openingScore = std::max(0, std::stoi(value));
+            } else if (key == "opening_nodes") {
+                config.openingNodes = std::max(1, std::stoi(value));
+            } else if (key == "hash_mb") {
+                config.hashMB = std::max(1, std::stoi(value));
+            } else if (key == "dedup_mb") {
+                config.dedupMB = std::max(0, std::stoi(value));
+            } else {
+                std::cerr << "Unknown datagen option: '" << key << "'!" << std::endl;
+            }
+        } catch ([[maybe_unused]] const std::exception &e) {
+            std::cerr << "Invalid value for datagen option '" << key << "': '" << value << "'!" << std::endl;
+        }
+    }
+
+    if (!hasSeed) {
+        std::random_device rd;
+        config.seed = static_cast<std::uint64_t>(rd()) << 32 | rd();
+    }
+
+    return hasOptions;
+}
+
+std::vector<std::string> loadOpeningBook(const std::string &path) {
+    std::vector<std::string> openings;
+    std::ifstream file(path);
+    std::string line;
+    std::string fen;
+
+    while (std::getline(file, line)) {
+        if (fenFromLine(line, fen)) {
+            openings.push_back(fen);
+        }
+    }
+
+    return openings;
+}
+
+void generate(const DatagenConfig &config, const std::vector<std::string> &openings, const int threadId,
+              const std::uint64_t positionQuota) {
+    tt transpositionTable(config.hashMB);
     TimeManagement timeManagement;
     Network net;
     const auto search =
             std::make_unique<Search>(timeManagement, transpositionTable, net);
-    SearchParams params;
-    params.minimal = true;
     Board board(&net);
     search->initLMR();
 
-    std::random_device rd;
-    std::mt19937 gen(rd() + threadId);
+    const std::string shardPath = shardFile(config.outputPath, threadId);
+    const std::string checkpointPath = checkpointFile(config.outputPath, threadId);
+
+    // Continue after the last checkpoint, runDatagen already cut off everything behind it
+    ShardCheckpoint checkpoint = readCheckpoint(checkpointPath);
 
-    // The persistent buffer for batching writes.
-    std::vector<std::string> writeBuffer;
+    std::ofstream shard(shardPath, std::ios::binary | std::ios::app);
+
+    std::uint64_t gameIndex = checkpoint.games;
+    std::uint64_t positions = checkpoint.positions;
+    totalPositionsGenerated += positions;
+
+    // The persistent buffer for batching writes, every game is appended in place
+    std::string writeBuffer;
 
     // Pre-allocate memory
-    writeBuffer.reserve(5120);
+    writeBuffer.reserve(WRITE_BUFFER_SIZE + (1 << 12));
+
+    // Collects the moves and scores of the current game, reused for every game
+    GameWriter gameWriter;
+    Adjudicator adjudicator(config);
+
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    auto commit = [&] {
+        shard.write(writeBuffer.data(), static_cast<std::streamsize>(writeBuffer.size()));
+        shard.flush();
+        checkpoint = {gameIndex, positions, checkpoint.bytes + writeBuffer.size()};
+        writeBuffer.clear();
+        writeCheckpoint(checkpointPath, checkpoint);
+        lastCheckpoint = std::chrono::steady_clock::now();
+    };
+
+    while (positions < positionQuota) {
+        std::mt19937_64 gen(gameSeed(config.seed, threadId, gameIndex++));
+
+        // Nothing may carry over from the previous game, otherwise it could not be replayed on its own
+        search->newGame();
 
-    while (totalPositionsGenerated < positionAmount) {
-        board.setFen(STARTPOS);
+        board.setFen(openings.empty() ? STARTPOS : openings[gen() % openings.size()]);
         bool exitEarly = false;
 
-        for (int i = 0; i < 10; i++) {
+        for (int i = 0; i < config.randomPlies; i++) {
             Movelist moveList;
             movegen::legalmoves(moveList, board);
             if (auto [fst, snd] = board.isGameOver(); snd != GameResult::NONE || moveList.empty()) {
@@ -70,76 +431,219 @@ void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmo
             board.makeMove(move);
         }
 
-        if (exitEarly) {
+        if (exitEarly || board.isGameOver().second != GameResult::NONE) {
             continue;
         }
 
-        // Temporary storage for the current game
-        std::vector<std::pair<std::string, int> > currentGameData;
-        std::string resultString = "none";
+        // Unbalanced openings only produce one sided games, so they are thrown away before playing them
+        if (config.openingScore > 0) {
+            if (std::abs(search->searchPosition(board, MAX_PLY, config.openingNodes).score) > config.openingScore) {
+                continue;
+            }
+        }
+
+        gameWriter.begin(board);
+        adjudicator.reset();
+        bool hasResult = false;
+        GameResult8 result = GameResult8::DRAW;
 
         // Play out the game
         for (int i = 0; i < 500; i++) {
             if (auto [fst, snd] = board.isGameOver(); snd != GameResult::NONE) {
-                if (snd == GameResult::DRAW) resultString = "0.5";
-                else resultString = snd == GameResult::LOSE && board.sideToMove() == Color::BLACK ? "1.0" : "0.0";
+                if (snd == GameResult::DRAW) result = GameResult8::DRAW;
+                else result = snd == GameResult::LOSE && board.sideToMove() == Color::BLACK
+                                  ? GameResult8::WHITE_WIN
+                                  : GameResult8::BLACK_WIN;
+                hasResult = true;
                 break;
             }
 
-            search->nodeLimit = 5000;
-            search->iterativeDeepening(board, params);
-            Move bestMove = search->rootBestMove;
-
-            if (bestMove.typeOf() == Move::PROMOTION || board.inCheck() || board.isCapture(bestMove) || std::abs(
-                    search->currentScore) >= 10000) {
-                board.makeMove(bestMove);
-                continue;
+            if (config.materialDraw && isMaterialDraw(board)) {
+                result = GameResult8::DRAW;
+                hasResult = true;
+                break;
             }
 
-            int score = board.sideToMove() == Color::WHITE ? search->currentScore : -search->currentScore;
+            const SearchResult searchResult = search->searchPosition(board, MAX_PLY, 5000);
+            Move bestMove = searchResult.bestMove;
+            int score = board.sideToMove() == Color::WHITE ? searchResult.score : -searchResult.score;
 
-            // Store FEN and score in the temporary container
-            currentGameData.emplace_back(board.getFen(), score);
+            // Every move is stored, so the game can be replayed, but only new quiet positions get a score
+            if (bestMove.typeOf() == Move::PROMOTION || board.inCheck() || board.isCapture(bestMove) || std::abs(
+                    searchResult.score) >= 10000) {
+                gameWriter.addPly(bestMove, PlyRecord::NO_SCORE);
+            } else if (duplicateFilter.isEnabled() && duplicateFilter.insert(board.hash())) {
+                gameWriter.addPly(bestMove, PlyRecord::NO_SCORE);
+                ++totalDuplicates;
+            } else {
+                gameWriter.addPly(bestMove, score);
+            }
 
             board.makeMove(bestMove);
+
+            if (adjudicator.update(i, score, result)) {
+                hasResult = true;
+                break;
+            }
         }
 
         // Discard incomplete games
-        if (resultString == "none") {
+        if (!hasResult || gameWriter.scoredPositions() == 0) {
             continue;
         }
 
-        // Append the result
-        for (const auto &[fst, snd]: currentGameData) {
-            std::string line = fst;
-            line.append(" | ");
-            line.append(std::to_string(snd));
-            line.append(" | ");
-            line.append(resultString);
-            writeBuffer.push_back(line);
+        gameWriter.finish(result, writeBuffer);
+        positions += gameWriter.scoredPositions();
+        totalPositionsGenerated += gameWriter.scoredPositions();
+
+        // Write in large sequential chunks
+        if (writeBuffer.size() >= WRITE_BUFFER_SIZE ||
+            std::chrono::steady_clock::now() - lastCheckpoint >= CHECKPOINT_INTERVAL) {
+            commit();
         }
-        totalPositionsGenerated += currentGameData.size();
+    }
+
+    // After the loop, write any remaining data in the buffer.
+    commit();
+    --runningThreads;
+}
 
-        // Check if the persistent buffer is full enough to write
-        if (writeBuffer.size() >= 5000) {
-            std::lock_guard guard(outputFileMutex);
-            for (const auto &line: writeBuffer) {
-                outputFile << line << "\n";
+void runDatagen(const DatagenConfig &config) {
+    DatagenConfig run = config;
+    const std::string manifestPath = manifestFile(config.outputPath);
+    std::uint64_t mergeOffset = NO_MERGE;
+    bool merged = false;
+
+    // The manifest of an interrupted run wins, its games can only be continued with the same settings
+    if (readManifest(manifestPath, run, mergeOffset, merged)) {
+        std::cout << (merged ? "Cleaning up the merged datagen run with " : "Resuming datagen with ")
+                << formatOptions(run) << std::endl;
+    } else if (run.positions == 0) {
+        std::cerr << "Datagen needs a positive amount of positions!" << std::endl;
+        return;
+    } else {
+        writeManifest(manifestPath, run, NO_MERGE);
+        std::cout << "Starting datagen with " << formatOptions(run) << std::endl;
+    }
+
+    if (mergeOffset == NO_MERGE) {
+        std::vector<std::string> openings;
+        if (!run.bookPath.empty()) {
+            openings = loadOpeningBook(run.bookPath);
+            if (openings.empty()) {
+                std::cerr << "Could not read any opening from '" << run.bookPath << "'!" << std::endl;
+                return;
             }
-            outputFile.flush();
+            std::cout << "Loaded " << openings.size() << " openings" << std::endl;
+        }
 
-            // Clear the buffer for the next batch
-            writeBuffer.clear();
+        duplicateFilter.resize(run.dedupMB);
+        for (int i = 0; i < run.threads; ++i) {
+            restoreShard(run, i);
         }
+
+        totalPositionsGenerated = 0;
+        totalDuplicates = 0;
+        runningThreads = run.threads;
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < run.threads; ++i) {
+            // Fixed quotas keep the content of every shard independent of the thread timing
+            const std::uint64_t quota = run.positions / run.threads + (static_cast<std::uint64_t>(i) < run.positions % run.threads);
+            threads.emplace_back(generate, std::cref(run), std::cref(openings), i, quota);
+        }
+
+        // Give the threads a moment to pick up their checkpoints, so the speed only counts new positions
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const std::uint64_t resumedPositions = totalPositionsGenerated.load();
+
+        // The share of scored positions that were skipped as duplicates in this session
+        auto duplicateInfo = [&resumedPositions] {
+            if (!duplicateFilter.isEnabled()) {
+                return std::string();
+            }
+
+            const std::uint64_t duplicates = totalDuplicates.load();
+            const std::uint64_t current = totalPositionsGenerated.load();
+            const std::uint64_t written = current - std::min(current, resumedPositions);
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(2) << " | Duplicates: "
+                    << (duplicates ? 100.0 * duplicates / (duplicates + written) : 0.0) << "% | "
+                    << "Filter: " << (duplicateFilter.memoryUsage() >> 20) << " MB";
+            return os.str();
+        };
+
+        // Periodically print statistics from the main thread
+        auto startTime = std::chrono::steady_clock::now();
+        while (runningThreads > 0) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - startTime).count();
+            if (elapsedTime > 0) {
+                // Use .load() for safe reading of atomic variable
+                auto currentPositions = totalPositionsGenerated.load();
+                double pps = static_cast<double>(currentPositions - std::min(currentPositions, resumedPositions)) /
+                             elapsedTime;
+
+                // Ensure ETA is never negative
+                double eta = (pps > 0 && currentPositions < run.positions)
+                                 ? (run.positions - currentPositions) / pps
+                                 : 0.0;
+
+                // Cap displayed progress at 100%
+                double progress = std::min(100.0, static_cast<double>(currentPositions) / run.positions * 100.0);
+
+                std::cout << "\r" << std::fixed << std::setprecision(2)
+                        << "Progress: " << progress << "% | "
+                        << "Positions: " << currentPositions << "/" << run.positions << " | "
+                        << "PPS: " << static_cast<int>(pps) << " | "
+                        << "ETA: " << static_cast<int>(eta) << "s" << duplicateInfo() << "   " << std::flush;
+            }
+        }
+
+        for (std::thread &t: threads) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+
+        // Print the progress bar
+        std::cout << "\r" << std::fixed << std::setprecision(2)
+                << "Progress: " << 100.00 << "% | "
+                << "Positions: " << totalPositionsGenerated.load() << "/" << run.positions << " | "
+                << "PPS: " << 0 << " | "
+                << "ETA: " << 0 << "s" << duplicateInfo() << "   " << std::endl;
+
+        // Remember where the output ended, so an interrupted merge can be redone without duplicating games
+        mergeOffset = std::filesystem::exists(run.outputPath) ? std::filesystem::file_size(run.outputPath) : 0;
+        writeManifest(manifestPath, run, mergeOffset);
+    } else if (!merged && std::filesystem::exists(run.outputPath)) {
+        std::filesystem::resize_file(run.outputPath, mergeOffset);
     }
 
-    // After the loop, write any remaining data in the buffer.
-    if (!writeBuffer.empty()) {
-        std::lock_guard guard(outputFileMutex);
-        for (const auto& line : writeBuffer) {
-            outputFile << line << "\n";
+    if (!merged) {
+        // The game records are self contained, so the shards can simply be concatenated
+        std::ofstream outputFile(run.outputPath, std::ios::app | std::ios::binary);
+        if (!outputFile.is_open()) {
+            std::cerr << "Error opening output file for datagen! The data is left in the shards." << std::endl;
+            return;
         }
-        outputFile.flush();
-        writeBuffer.clear();
+
+        for (int i = 0; i < run.threads; ++i) {
+            std::ifstream shard(shardFile(run.outputPath, i), std::ios::binary);
+            if (shard.peek() != std::ifstream::traits_type::eof()) {
+                outputFile << shard.rdbuf();
+            }
+        }
+        outputFile.close();
+
+        // The merge is recorded before any shard is removed, a resume with missing shards would lose games
+        writeManifest(manifestPath, run, mergeOffset, true);
+    }
+
+    for (int i = 0; i < run.threads; ++i) {
+        std::filesystem::remove(shardFile(run.outputPath, i));
+        std::filesystem::remove(checkpointFile(run.outputPath, i));
     }
-}
\ No newline at end of file
+    std::filesystem::remove(manifestPath);
+}
@@ -21,8 +21,57 @@
 #define DATAGEN_H
 
 #include <cstdint>
-#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
 
-void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmount);
+struct DatagenConfig {
+    int threads = 1;
+    std::uint64_t positions = 0;
+    std::uint64_t seed = 0;
+    std::string outputPath = "output.bin";
+
+    // Games start from a random line of the book, or from the start position without one,
+    // followed by randomPlies random moves
+    std::string bookPath;
+    int randomPlies = 10;
+
+    // Openings whose verification search scores beyond openingScore are thrown away, e.g. opening_score=1000.
+    // The check is disabled by default, so runs without it keep their speed and distribution
+    int openingScore = 0;
+    int openingNodes = 5000;
+
+    // Size of the transposition table of every thread, it is cleared before every game
+    int hashMB = 16;
+
+    // Size of the Bloom filter that skips positions which were already written, 0 disables it
+    int dedupMB = 64;
+
+    // Adjudication ends games whose outcome is already clear, a value of 0 disables a rule.
+    // Scores are from white's point of view and plies are counted after the opening
+    int winPlies = 5; // Consecutive plies with a score beyond winScore for the same side
+    int winScore = 2000;
+    int drawPly = 80; // No score based draw before this ply
+    int drawPlies = 10; // Consecutive plies with a score within drawScore
+    int drawScore = 10;
+    bool materialDraw = true; // Rook or minor piece against rook or minor piece without pawns
+};
+
+// Parses 'threads=N positions=M seed=S out=path' and the adjudication options like 'win_plies=K',
+// returns false if no option was given
+// A missing seed is drawn at random, the run stays reproducible because it is stored in the checkpoint
+bool parseDatagenOptions(std::istringstream &is, DatagenConfig &config);
+
+// Reads the FEN of every line of an EPD or FEN file, missing move counters are filled in
+std::vector<std::string> loadOpeningBook(const std::string &path);
+
+// Plays games until the thread generated positionQuota positions and writes them to its own shard file
+// Every game only depends on the seed, the thread and the game index, so an interrupted shard can be continued
+void generate(const DatagenConfig &config, const std::vector<std::string> &openings, int threadId,
+              std::uint64_t positionQuota);
+
+// Runs datagen and appends the games of all shards to the output file
+// If a previous run with the same output file got interrupted, it is resumed from its last checkpoint
+void runDatagen(const DatagenConfig &config);
 
 #endif
@@ -0,0 +1,233 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "evalbatch.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "gamerecord.h"
+
+void EvalBatch::handleEvalBatch(std::istringstream &is) {
+    std::string inputPath, outputPath, token;
+    is >> inputPath >> outputPath;
+
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    bool binaryOutput = false;
+    while (is >> token) {
+        if (token.starts_with("threads=")) {
+            try {
+                threads = std::max(1, std::stoi(token.substr(8)));
+            } catch ([[maybe_unused]] const std::exception &e) {
+                std::cerr << "Invalid number of threads: '" << token << "'!" << std::endl;
+            }
+        } else if (token == "format=binary") {
+            binaryOutput = true;
+        } else if (token != "format=text") {
+            std::cerr << "Unknown evalbatch option: '" << token << "'!" << std::endl;
+        }
+    }
+
+    if (inputPath.empty() || outputPath.empty()) {
+        std::cerr << "Usage: evalbatch <in> <out> [threads=N] [format=text|binary]" << std::endl;
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint64_t positions = run(inputPath, outputPath, threads, binaryOutput);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Evaluated " << positions << " positions in " << elapsed.count() << "s ("
+            << static_cast<std::uint64_t>(positions / std::max(elapsed.count(), 1e-9)) << " positions/s)"
+            << std::endl;
+}
+
+int EvalBatch::evaluate(Network &net, Board &board, const std::string_view line, std::string &fen) {
+    if (!fenFromLine(line, fen)) {
+        return NO_SCORE;
+    }
+    board.setFen(fen);
+
+    // Collect the features of every piece and build the accumulator in one pass
+    std::array<std::uint16_t, 32> whiteFeatures;
+    std::array<std::uint16_t, 32> blackFeatures;
+    int count = 0;
+
+    Bitboard occupied = board.occ();
+    while (occupied && count < 32) {
+        const Square square = occupied.pop();
+        const Piece piece = board.at(square);
+        Network::featureIndices(static_cast<std::uint8_t>(piece.type()), static_cast<std::uint8_t>(piece.color()),
+                                static_cast<std::uint8_t>(square.index()), whiteFeatures[count],
+                                blackFeatures[count]);
+        count++;
+    }
+
+    net.refreshAccumulator(whiteFeatures.data(), blackFeatures.data(), count);
+    const int eval = net.evaluate(board.sideToMove(), count);
+    return std::clamp(board.sideToMove() == Color::WHITE ? eval : -eval, NO_SCORE + 1, 32767);
+}
+
+void EvalBatch::read(std::ifstream &input, Batch &batch) {
+    batch.lineCount = 0;
+    while (batch.lineCount < BATCH_SIZE && std::getline(input, batch.lines[batch.lineCount])) {
+        batch.lineCount++;
+    }
+}
+
+std::uint64_t EvalBatch::write(std::ofstream &output, const Batch &batch, const bool binaryOutput,
+                               std::string &buffer) {
+    std::uint64_t positions = 0;
+    buffer.clear();
+    for (std::size_t line = 0; line < batch.lineCount; line++) {
+        const std::int16_t score = batch.scores[line];
+        if (score != NO_SCORE) {
+            positions++;
+        }
+
+        if (binaryOutput) {
+            buffer.append(reinterpret_cast<const char *>(&score), sizeof(std::int16_t));
+        } else if (score == NO_SCORE) {
+            buffer.append("none\n");
+        } else {
+            buffer.append(std::to_string(score));
+            buffer.push_back('\n');
+        }
+    }
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return positions;
+}
+
+std::uint64_t EvalBatch::run(const std::string &inputPath, const std::string &outputPath, const int threads,
+                             const bool binaryOutput) {
+    std::ifstream input(inputPath);
+    if (!input.is_open()) {
+        std::cerr << "Could not open " << inputPath << std::endl;
+        return 0;
+    }
+
+    std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        std::cerr << "Could not open " << outputPath << std::endl;
+        return 0;
+    }
+
+    // While the workers evaluate one batch, the next one is read and the previous one is written
+    std::array<Batch, 2> batches;
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    Batch *current = nullptr;
+    std::uint64_t generation = 0;
+    int pending = 0;
+    bool quit = false;
+
+    // The workers live for the whole run and sleep between the batches.
+    // Every thread needs its own accumulator, so it gets its own network
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back([&, i] {
+            const std::unique_ptr<Network> net = std::make_unique<Network>();
+            // The accumulator is built from the features, so the board skips the incremental updates
+            Board board(nullptr);
+            std::string fen;
+            std::uint64_t seenGeneration = 0;
+
+            while (true) {
+                std::unique_lock lock(mutex);
+                startCondition.wait(lock, [&] { return quit || generation != seenGeneration; });
+                if (quit) {
+                    return;
+                }
+                seenGeneration = generation;
+                Batch &batch = *current;
+                lock.unlock();
+
+                // Every thread evaluates a contiguous slice of the batch, the scores keep the order of the lines
+                const std::size_t sliceSize = (batch.lineCount + threads - 1) / threads;
+                const std::size_t first = std::min(batch.lineCount, i * sliceSize);
+                const std::size_t last = std::min(batch.lineCount, first + sliceSize);
+                for (std::size_t line = first; line < last; line++) {
+                    batch.scores[line] = static_cast<std::int16_t>(evaluate(*net, board, batch.lines[line], fen));
+                }
+
+                lock.lock();
+                if (--pending == 0) {
+                    doneCondition.notify_one();
+                }
+            }
+        });
+    }
+
+    auto startBatch = [&](Batch &batch) {
+        std::lock_guard lock(mutex);
+        current = &batch;
+        pending = threads;
+        generation++;
+        startCondition.notify_all();
+    };
+
+    auto waitForBatch = [&] {
+        std::unique_lock lock(mutex);
+        doneCondition.wait(lock, [&] { return pending == 0; });
+    };
+
+    std::string buffer;
+    std::uint64_t positions = 0;
+    int index = 0;
+
+    read(input, batches[index]);
+    if (batches[index].lineCount > 0) {
+        startBatch(batches[index]);
+
+        while (true) {
+            Batch &next = batches[index ^ 1];
+            read(input, next);
+            waitForBatch();
+
+            if (next.lineCount > 0) {
+                startBatch(next);
+            }
+            positions += write(output, batches[index], binaryOutput, buffer);
+
+            if (next.lineCount == 0) {
+                break;
+            }
+            index ^= 1;
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        quit = true;
+    }
+    startCondition.notify_all();
+    for (std::thread &worker: workers) {
+        worker.join();
+    }
+
+    return positions;
+}
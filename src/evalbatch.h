@@ -0,0 +1,70 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVALBATCH_H
+#define EVALBATCH_H
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chess.hpp"
+#include "NNUE/nnue.h"
+using namespace chess;
+
+// Labels large position files with raw network scores, e.g. to filter training data.
+// Every input line gets one output score, so the output stays aligned with the input
+class EvalBatch {
+public:
+    // Marks lines without a valid position in the output
+    static constexpr std::int16_t NO_SCORE = std::numeric_limits<std::int16_t>::min();
+
+    // Parses 'evalbatch <in> <out> [threads=N] [format=text|binary]'
+    static void handleEvalBatch(std::istringstream &is);
+
+    // Returns the amount of evaluated positions. Text output has one score per line,
+    // binary output one int16 per line. Scores are from white's point of view
+    static std::uint64_t run(const std::string &inputPath, const std::string &outputPath, int threads,
+                             bool binaryOutput);
+
+    // Evaluates the position of a line without making any moves, the board does not need a network
+    static int evaluate(Network &net, Board &board, std::string_view line, std::string &fen);
+
+private:
+    // The amount of lines read at once and split between the threads
+    static constexpr std::size_t BATCH_SIZE = 1 << 16;
+
+    struct Batch {
+        std::vector<std::string> lines = std::vector<std::string>(BATCH_SIZE);
+        std::vector<std::int16_t> scores = std::vector<std::int16_t>(BATCH_SIZE);
+        std::size_t lineCount = 0;
+    };
+
+    // Reads the next lines of the input into the batch
+    static void read(std::ifstream &input, Batch &batch);
+
+    // Writes the scores of the batch and returns the amount of valid positions
+    static std::uint64_t write(std::ofstream &output, const Batch &batch, bool binaryOutput, std::string &buffer);
+};
+
+#endif
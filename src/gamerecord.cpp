@@ -0,0 +1,284 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "gamerecord.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+PackedBoard PackedBoard::pack(const Board &board, const GameResult8 result) {
+    PackedBoard packed{};
+
+    Bitboard occupied = board.occ();
+    packed.occupancy = occupied.getBits();
+
+    int index = 0;
+    while (occupied) {
+        const Square square = occupied.pop();
+        const auto piece = static_cast<std::uint8_t>(static_cast<int>(board.at(square)));
+        packed.pieces[index / 2] |= piece << (index % 2 * 4);
+        index++;
+    }
+
+    const Board::CastlingRights rights = board.castlingRights();
+    packed.castling = rights.has(Color::WHITE, Board::CastlingRights::Side::KING_SIDE) |
+                      rights.has(Color::WHITE, Board::CastlingRights::Side::QUEEN_SIDE) << 1 |
+                      rights.has(Color::BLACK, Board::CastlingRights::Side::KING_SIDE) << 2 |
+                      rights.has(Color::BLACK, Board::CastlingRights::Side::QUEEN_SIDE) << 3;
+
+    packed.sideToMove = board.sideToMove() == Color::BLACK;
+    packed.enPassant = board.enpassantSq() == Square::underlying::NO_SQ ? 64 : board.enpassantSq().index();
+    packed.halfMoveClock = static_cast<std::uint8_t>(std::min(board.halfMoveClock(), 255u));
+    packed.fullMoveNumber = static_cast<std::uint16_t>(std::min(board.fullMoveNumber(), 65535u));
+    packed.result = result;
+
+    return packed;
+}
+
+void PackedBoard::unpack(Board &board) const {
+    constexpr std::string_view pieceChars = "PNBRQKpnbrqk";
+
+    // We build a FEN from the packed position, so the board is set up by the usual code
+    FenBuffer buffer;
+    char *out = buffer.data();
+    char *const end = buffer.data() + buffer.size();
+
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            if (const int square = rank * 8 + file; occupancy >> square & 1) {
+                if (empty > 0) {
+                    *out++ = static_cast<char>('0' + empty);
+                    empty = 0;
+                }
+                // The pieces are packed in the order of the squares, but the FEN starts with the 8th rank
+                const int index = std::popcount(occupancy & ((1ULL << square) - 1));
+                *out++ = pieceChars[pieces[index / 2] >> (index % 2 * 4) & 0xF];
+            } else {
+                empty++;
+            }
+        }
+        if (empty > 0) {
+            *out++ = static_cast<char>('0' + empty);
+        }
+        if (rank > 0) {
+            *out++ = '/';
+        }
+    }
+
+    *out++ = ' ';
+    *out++ = sideToMove ? 'b' : 'w';
+    *out++ = ' ';
+
+    if (castling == 0) {
+        *out++ = '-';
+    } else {
+        constexpr std::string_view castlingChars = "KQkq";
+        for (int i = 0; i < 4; i++) {
+            if (castling >> i & 1) {
+                *out++ = castlingChars[i];
+            }
+        }
+    }
+
+    *out++ = ' ';
+    if (enPassant >= 64) {
+        *out++ = '-';
+    } else {
+        *out++ = static_cast<char>('a' + enPassant % 8);
+        *out++ = static_cast<char>('1' + enPassant / 8);
+    }
+
+    *out++ = ' ';
+    out = std::to_chars(out, end, halfMoveClock).ptr;
+    if (out < end) {
+        *out++ = ' ';
+    }
+    out = std::to_chars(out, end, fullMoveNumber).ptr;
+
+    board.setFen(std::string_view(buffer.data(), out - buffer.data()));
+}
+
+void GameWriter::begin(const Board &board) {
+    startBoard = board;
+    plies.clear();
+    scoredPlies = 0;
+}
+
+void GameWriter::addPly(const Move move, const int score) {
+    PlyRecord &ply = plies.emplace_back();
+    ply.move = move.move();
+
+    if (score == PlyRecord::NO_SCORE) {
+        ply.score = PlyRecord::NO_SCORE;
+    } else {
+        ply.score = static_cast<std::int16_t>(std::clamp(score, -32767, 32767));
+        scoredPlies++;
+    }
+}
+
+void GameWriter::finish(const GameResult8 result, std::string &output) const {
+    const PackedBoard header = PackedBoard::pack(startBoard, result);
+    constexpr PlyRecord terminator{0, 0};
+
+    output.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.append(reinterpret_cast<const char *>(plies.data()), plies.size() * sizeof(PlyRecord));
+    output.append(reinterpret_cast<const char *>(&terminator), sizeof(terminator));
+}
+
+GameReader::GameReader(const std::string &path) : input(path, std::ios::binary) {
+    plies.reserve(512);
+}
+
+bool GameReader::nextGame() {
+    if (!input.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return false;
+    }
+
+    plies.clear();
+    PlyRecord ply{};
+    while (input.read(reinterpret_cast<char *>(&ply), sizeof(ply))) {
+        if (ply.move == Move::NO_MOVE) {
+            return true;
+        }
+        plies.push_back(ply);
+    }
+
+    // The file ended in the middle of a game, for example because datagen was killed
+    return false;
+}
+
+void appendPositionText(std::string &output, const Board &board, const int score, const GameResult8 result) {
+    FenBuffer fen;
+    char scoreText[16];
+    const char *scoreEnd = std::to_chars(scoreText, scoreText + sizeof(scoreText), score).ptr;
+
+    output.append(board.getFen(fen));
+    output.append(" | ");
+    output.append(scoreText, scoreEnd - scoreText);
+    output.append(result == GameResult8::WHITE_WIN ? " | 1.0\n" : result == GameResult8::DRAW
+                                                                    ? " | 0.5\n"
+                                                                    : " | 0.0\n");
+}
+
+bool fenFromLine(std::string_view line, std::string &fen) {
+    line = line.substr(0, line.find('|'));
+
+    // An EPD line has the four board fields followed by operations, a FEN line the two move counters
+    std::array<std::string_view, 6> fields;
+    std::size_t fieldCount = 0;
+    while (fieldCount < fields.size()) {
+        const std::size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos) {
+            break;
+        }
+        line.remove_prefix(start);
+        const std::size_t end = std::min(line.find_first_of(" \t\r"), line.size());
+        fields[fieldCount++] = line.substr(0, end);
+        line.remove_prefix(end);
+    }
+
+    if (fieldCount < 4 || fields[0][0] == '#') {
+        return false;
+    }
+
+    const auto isNumber = [](const std::string_view token) {
+        return std::all_of(token.begin(), token.end(), [](const char c) { return std::isdigit(c); });
+    };
+    const bool hasCounters = fieldCount == 6 && isNumber(fields[4]) && isNumber(fields[5]);
+
+    fen.clear();
+    for (std::size_t i = 0; i < (hasCounters ? 6 : 4); i++) {
+        fen.append(fields[i]);
+        fen.push_back(' ');
+    }
+    if (!hasCounters) {
+        fen.append("0 1 ");
+    }
+    fen.pop_back();
+
+    return true;
+}
+
+bool parsePositionText(std::string_view line, Board &board, int &score, GameResult8 &result) {
+    const std::size_t scoreStart = line.find('|');
+    const std::size_t resultStart = line.find('|', scoreStart + 1);
+    if (scoreStart == std::string_view::npos || resultStart == std::string_view::npos) {
+        return false;
+    }
+
+    auto trim = [](std::string_view text) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+        return text;
+    };
+
+    const std::string_view scoreText = trim(line.substr(scoreStart + 1, resultStart - scoreStart - 1));
+    if (std::from_chars(scoreText.data(), scoreText.data() + scoreText.size(), score).ec != std::errc()) {
+        return false;
+    }
+
+    const std::string_view resultText = trim(line.substr(resultStart + 1));
+    if (resultText == "1.0" || resultText == "1") result = GameResult8::WHITE_WIN;
+    else if (resultText == "0.5") result = GameResult8::DRAW;
+    else if (resultText == "0.0" || resultText == "0") result = GameResult8::BLACK_WIN;
+    else return false;
+
+    board.setFen(trim(line.substr(0, scoreStart)));
+    return true;
+}
+
+std::uint64_t GameReader::convertToText(const std::string &inputPath, const std::string &outputPath) {
+    GameReader reader(inputPath);
+    if (!reader.isOpen()) {
+        std::cerr << "Could not open " << inputPath << std::endl;
+        return 0;
+    }
+
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!output.is_open()) {
+        std::cerr << "Could not open " << outputPath << std::endl;
+        return 0;
+    }
+
+    std::string buffer;
+    buffer.reserve(1 << 20);
+    std::uint64_t positions = 0;
+
+    Board board;
+    while (reader.nextGame()) {
+        reader.forEachPosition(board, [&](const Board &position, const int score, const GameResult8 result) {
+            appendPositionText(buffer, position, score, result);
+            positions++;
+        });
+
+        if (buffer.size() >= 1 << 20) {
+            output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return positions;
+}
@@ -0,0 +1,154 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMERECORD_H
+#define GAMERECORD_H
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chess.hpp"
+using namespace chess;
+
+// A game is stored as the packed start position followed by one record per ply and a zero record.
+// Every position costs 4 bytes, the trainer replays the moves instead of parsing FENs.
+// All values are written in the byte order of the machine, which is little endian on every platform we use.
+
+enum class GameResult8 : std::uint8_t {
+    BLACK_WIN,
+    DRAW,
+    WHITE_WIN
+};
+
+// The start position of a game in 32 bytes
+struct PackedBoard {
+    // Every set bit is an occupied square
+    std::uint64_t occupancy;
+    // One nibble with the piece for every occupied square, in the order of the squares
+    std::uint8_t pieces[16];
+    std::uint8_t sideToMove;
+    // The en passant square or 64 if there is none
+    std::uint8_t enPassant;
+    // Bit 0 white king side, bit 1 white queen side, bit 2 black king side, bit 3 black queen side
+    std::uint8_t castling;
+    std::uint8_t halfMoveClock;
+    std::uint16_t fullMoveNumber;
+    GameResult8 result;
+    std::uint8_t reserved;
+
+    static PackedBoard pack(const Board &board, GameResult8 result);
+
+    // Sets up the board from the packed position. Only standard chess castling is supported
+    void unpack(Board &board) const;
+};
+
+static_assert(sizeof(PackedBoard) == 32);
+
+// A single scored position, the fixed size record of shuffled training data
+struct PackedPosition {
+    PackedBoard board;
+    // The score from white's point of view, the result is stored in the board
+    std::int16_t score;
+    std::uint8_t padding[6];
+};
+
+static_assert(sizeof(PackedPosition) == 40);
+
+// Appends the position as a 'FEN | score | result' line
+void appendPositionText(std::string &output, const Board &board, int score, GameResult8 result);
+
+// Extracts the FEN of an EPD, FEN or 'FEN | score | result' line, missing move counters are filled in.
+// Returns false for lines without a position, like empty lines or '#' comments
+bool fenFromLine(std::string_view line, std::string &fen);
+
+// Parses a 'FEN | score | result' line, returns false if the line is malformed
+bool parsePositionText(std::string_view line, Board &board, int &score, GameResult8 &result);
+
+struct PlyRecord {
+    std::uint16_t move;
+    // The score of the position before the move from white's point of view
+    std::int16_t score;
+
+    // Positions we don't want to train on, like positions in check, are stored without a score
+    static constexpr std::int16_t NO_SCORE = std::numeric_limits<std::int16_t>::min();
+};
+
+static_assert(sizeof(PlyRecord) == 4);
+
+// Collects the plies of one game and appends the finished record to a buffer
+class GameWriter {
+    Board startBoard;
+    std::vector<PlyRecord> plies;
+    int scoredPlies = 0;
+
+public:
+    GameWriter() {
+        plies.reserve(512);
+    }
+
+    void begin(const Board &board);
+
+    // score is from white's point of view or PlyRecord::NO_SCORE
+    void addPly(Move move, int score);
+
+    [[nodiscard]] int scoredPositions() const {
+        return scoredPlies;
+    }
+
+    // Appends the binary game record to the output
+    void finish(GameResult8 result, std::string &output) const;
+};
+
+// Reads the games of a file one after the other and replays them
+class GameReader {
+    std::ifstream input;
+    PackedBoard header{};
+    std::vector<PlyRecord> plies;
+
+public:
+    explicit GameReader(const std::string &path);
+
+    [[nodiscard]] bool isOpen() const {
+        return input.is_open();
+    }
+
+    // Reads the next game, returns false at the end of the file
+    bool nextGame();
+
+    // Calls callback(board, score, result) for every scored position of the current game
+    template<typename Callback>
+    void forEachPosition(Board &board, Callback &&callback) const {
+        header.unpack(board);
+        for (const PlyRecord &ply: plies) {
+            if (ply.score != PlyRecord::NO_SCORE) {
+                callback(static_cast<const Board &>(board), static_cast<int>(ply.score), header.result);
+            }
+            board.makeMove(Move(ply.move));
+        }
+    }
+
+    // Writes every scored position as 'FEN | score | result' lines, returns the amount of positions
+    static std::uint64_t convertToText(const std::string &inputPath, const std::string &outputPath);
+};
+
+#endif
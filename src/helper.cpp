@@ -23,6 +23,10 @@
 #include <chrono>
 #include <thread>
 
+std::string Helper::lastPositionCommand;
+std::uint64_t Helper::lastPositionHash = 0;
+bool Helper::lastPositionHasMoves = false;
+
 void Helper::transpositionTableTest(const tt &transpositionTable) {
     Board board;
     // Set up a unique position
@@ -58,7 +62,9 @@ void Helper::transpositionTableTest(const tt &transpositionTable) {
 void Helper::uciPrint() {
     std::cout << "id name Schoenemann" << std::endl
             << "option name Hash type spin default 64 min 1 max 4096" << std::endl
-            << "option name Threads type spin default 1 min 1 max 1" << std::endl;
+            << "option name Threads type spin default 1 min 1 max 1" << std::endl
+            << "option name MultiPV type spin default 1 min 1 max " << MAX_MOVES << std::endl
+            << "option name Ponder type check default false" << std::endl;
 }
 
 void Helper::runBenchmark(Search *search, Board &board, SearchParams &params) {
@@ -89,44 +95,95 @@ void Helper::runBenchmark(Search *search, Board &board, SearchParams &params) {
     // Prints out the final bench
     std::cout << "Time  : " << timeInMs << " ms\nNodes : " << nodes << "\nNPS   : " << NPS << std::endl;
 
-    board.setFen(STARTPOS);
+    resetBoard(board);
 }
 
-void Helper::handleSetPosition(Board &board, std::istringstream &is, std::string &token) {
+void Helper::resetBoard(Board &board) {
     board.setFen(STARTPOS);
-    std::string fen;
-    std::vector<std::string> moves;
-    bool isFen = false;
-    while (is >> token) {
+
+    lastPositionCommand.clear();
+    lastPositionHash = 0;
+    lastPositionHasMoves = false;
+}
+
+void Helper::handleSetPosition(Board &board, std::istringstream &is) {
+    // We parse the rest of the command in place, so no token is copied into a string
+    const std::streamoff offset = is.tellg();
+    std::string_view command = offset < 0 ? std::string_view() : is.view().substr(offset);
+
+    // Strip the surrounding whitespace, so the command can be compared with the previous one
+    command.remove_prefix(std::min(command.find_first_not_of(" \t"), command.size()));
+    command.remove_suffix(command.size() - std::min(command.find_last_not_of(" \t\r\n") + 1, command.size()));
+
+    const std::string_view fullCommand = command;
+
+    auto nextToken = [&command]() {
+        const std::size_t start = std::min(command.find_first_not_of(" \t"), command.size());
+        const std::size_t end = std::min(command.find_first_of(" \t", start), command.size());
+        const std::string_view token = command.substr(start, end - start);
+        command.remove_prefix(end);
+        return token;
+    };
+
+    std::string_view token;
+
+    // During a game the GUI sends the same position with one or two more moves every time.
+    // If the board is still in the position of the last command, we only play the new moves
+    // and keep the accumulator instead of replaying the whole game.
+    bool extendsLastPosition = !lastPositionCommand.empty() && board.hash() == lastPositionHash &&
+                               fullCommand.starts_with(lastPositionCommand) &&
+                               (fullCommand.size() == lastPositionCommand.size() ||
+                                fullCommand[lastPositionCommand.size()] == ' ');
+
+    // Without moves in the last command, anything but the start of a move list changes the position itself
+    if (extendsLastPosition && !lastPositionHasMoves) {
+        std::string_view rest = fullCommand.substr(lastPositionCommand.size());
+        rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+        extendsLastPosition = rest.empty() || rest == "moves" || rest.starts_with("moves ");
+    }
+
+    if (extendsLastPosition) {
+        command.remove_prefix(lastPositionCommand.size());
+        token = lastPositionHasMoves ? std::string_view("moves") : nextToken();
+    } else {
+        token = nextToken();
+
         if (token == "fen") {
-            isFen = true;
-            while (is >> token && token != "moves") {
-                fen += token + " ";
+            // The FEN reaches up to the moves token or the end of the command
+            const char *fenStart = command.data();
+            const char *fenEnd = fenStart;
+            while (!(token = nextToken()).empty() && token != "moves") {
+                fenEnd = token.data() + token.size();
             }
-            fen = fen.substr(0, fen.size() - 1);
-            board.setFen(fen);
-        } else if (token != "moves" && isFen) {
-            moves.push_back(token);
-        } else if (token == "startpos") {
+            board.setFen(std::string_view(fenStart, fenEnd - fenStart));
+        } else {
             board.setFen(STARTPOS);
-            isFen = true;
+            token = nextToken();
         }
     }
 
-    for (const std::string &move: moves) {
-        board.makeMove(uci::uciToMove(board, move));
+    lastPositionHasMoves = token == "moves";
+
+    if (token == "moves") {
+        while (!(token = nextToken()).empty()) {
+            board.makeMove(uci::uciToMove(board, token));
+        }
     }
+
+    lastPositionCommand = fullCommand;
+    lastPositionHash = board.hash();
 }
 
 
 void Helper::handleGo(Search &search, TimeManagement &timeManagement, Board &board,
-                      std::istringstream &is, SearchParams params) {
+                      std::istringstream &is, SearchParams &params) {
 
     // Reset everything for a new search
     params.isInfinite = false;
     params.depth = MAX_PLY;
 
     search.nodeLimit = Search::NO_NODE_LIMIT;
+    search.pondering = false;
     timeManagement.reset();
 
     // Setup values
@@ -142,6 +199,7 @@ void Helper::handleGo(Search &search, TimeManagement &timeManagement, Board &boa
         else if (token == "nodes") { is >> search.nodeLimit; }
         else if (token == "movetime") { is >> movetime; }
         else if (token == "infinite") { params.isInfinite = true; }
+        else if (token == "ponder")   { search.pondering = true; }
     }
 
     // We search infinite so no time calculation is needed
@@ -30,10 +30,20 @@ public:
 
     static void uciPrint();
 
-    static void handleSetPosition(Board &board, std::istringstream &is, std::string &token);
+    static void handleSetPosition(Board &board, std::istringstream &is);
+
+    // Sets the board to the start position. Every reset outside of a position command has to go through here,
+    // otherwise the next position command could continue from the cached position with a wrong history
+    static void resetBoard(Board &board);
 
     static void handleGo(Search &search, TimeManagement &timeManagement, Board &board, std::istringstream &is,
-                     SearchParams params);
+                     SearchParams &params);
+
+private:
+    // The last position command and the hash it ended in, so the next command can continue from it
+    static std::string lastPositionCommand;
+    static std::uint64_t lastPositionHash;
+    static bool lastPositionHasMoves;
 };
 
 #endif
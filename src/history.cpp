@@ -22,11 +22,13 @@
 #include "history.h"
 
 #include <cassert>
+#include <algorithm>
 
 #include "tune.h"
 
 DEFINE_PARAM(quietHistoryDiv, 28000, 10000, 50000);
 DEFINE_PARAM(continuationHistoryDiv, 28000, 10000, 50000);
+DEFINE_PARAM(captureHistoryDiv, 28000, 10000, 50000);
 DEFINE_PARAM(correctionValueDiv, 30, 1, 600);
 
 int History::getQuietHistory(const Board &board, const Move move) const {
@@ -47,23 +49,20 @@ int History::getContinuationHistory(PieceType piece, const Move move, int ply, c
 
     assert(piece != PieceType::NONE);
 
-    if (ply > 0 && stack[ply - 1].previousMovedPiece != PieceType::NONE) {
-        score += 2 * continuationHistory[stack[ply - 1].previousMovedPiece]
-                [stack[ply - 1].previousMove.to().index()]
-                [piece]
-                [to];
+    if (ply > 0 && stack[ply - 1].continuationHistory != nullptr) {
+        score += 2 * (*stack[ply - 1].continuationHistory)[piece][to];
     }
-    if (ply > 1 && stack[ply - 2].previousMovedPiece != PieceType::NONE) {
-        score += continuationHistory[stack[ply - 2].previousMovedPiece]
-                [stack[ply - 2].previousMove.to().index()]
-                [piece]
-                [to];
+    if (ply > 1 && stack[ply - 2].continuationHistory != nullptr) {
+        score += (*stack[ply - 2].continuationHistory)[piece][to];
     }
 
-
     return score;
 }
 
+PieceToHistory *History::getContinuationTable(const PieceType piece, const Move move) {
+    return &continuationHistory[piece][move.to().index()];
+}
+
 void History::updateContinuationHistory(const PieceType piece, const Move move, const int bonus, const int ply,
                                         const SearchStack *stack) {
     assert(piece != PieceType::NONE);
@@ -73,21 +72,40 @@ void History::updateContinuationHistory(const PieceType piece, const Move move,
 
     const int to = move.to().index();
 
-    if (ply > 0 && stack[ply - 1].previousMovedPiece != PieceType::NONE) {
-        continuationHistory[stack[ply - 1].previousMovedPiece]
-                [stack[ply - 1].previousMove.to().index()]
-                [piece]
-                [to] += gravity;
+    // The entries are only 16 bit wide, so we clamp them instead of letting them overflow
+    auto apply = [gravity](std::int16_t &entry) {
+        entry = static_cast<std::int16_t>(std::clamp(entry + gravity, -32767, 32767));
+    };
+
+    if (ply > 0 && stack[ply - 1].continuationHistory != nullptr) {
+        apply((*stack[ply - 1].continuationHistory)[piece][to]);
     }
 
-    if (ply > 1 && stack[ply - 2].previousMovedPiece != PieceType::NONE) {
-        continuationHistory[stack[ply - 2].previousMovedPiece]
-                [stack[ply - 2].previousMove.to().index()]
-                [piece]
-                [to] += gravity;
+    if (ply > 1 && stack[ply - 2].continuationHistory != nullptr) {
+        apply((*stack[ply - 2].continuationHistory)[piece][to]);
     }
 }
 
+int History::getCaptureHistory(const Board &board, const Move move) const {
+    return captureHistory[board.at(move.from())][move.to().index()][board.at<PieceType>(move.to())];
+}
+
+void History::updateCaptureHistory(const Board &board, const Move move, const int bonus) {
+    captureHistory
+            [board.at(move.from())]
+            [move.to().index()]
+            [board.at<PieceType>(move.to())] +=
+            bonus - getCaptureHistory(board, move) * std::abs(bonus) / captureHistoryDiv;
+}
+
+Move History::getCounterMove(const Move previousMove) const {
+    return counterMoves[previousMove.from().index()][previousMove.to().index()];
+}
+
+void History::updateCounterMove(const Move previousMove, const Move move) {
+    counterMoves[previousMove.from().index()][previousMove.to().index()] = move;
+}
+
 void History::updatePawnCorrectionHistory(const int bonus, const Board &board, const int div) {
     const std::uint64_t pawnHash = getPieceKey(PieceType::PAWN, board);
     // Gravity
@@ -119,4 +137,6 @@ void History::resetHistories() {
     std::memset(&quietHistory, 0, sizeof(quietHistory));
     std::memset(&continuationHistory, 0, sizeof(continuationHistory));
     std::memset(&pawnCorrectionHistory, 0, sizeof(pawnCorrectionHistory));
+    std::memset(&counterMoves, 0, sizeof(counterMoves));
+    std::memset(&captureHistory, 0, sizeof(captureHistory));
 }
@@ -23,8 +23,14 @@
 
 class History {
     int quietHistory[2][7][64] = {};
-    int continuationHistory[6][64][6][64] = {};
+    // 16 bit entries keep the table small enough to stay in the cache. It is indexed by the piece type and
+    // target square of the previous move, the search stack stores a pointer to that part of the table
+    PieceToHistory continuationHistory[6][64] = {};
+    // Indexed by the moving piece, the target square and the captured piece type
+    int captureHistory[12][64][7] = {};
     int pawnCorrectionHistory[2][16384] = {};
+    // The quiet move which refuted a move last time, indexed by the from and to square of that move
+    Move counterMoves[64][64] = {};
 
 private:
     static std::uint64_t getPieceKey(PieceType piece, const Board &board);
@@ -36,6 +42,12 @@ public:
 
     int getContinuationHistory(PieceType piece, Move move, int ply, const SearchStack *stack) const;
 
+    [[nodiscard]] PieceToHistory *getContinuationTable(PieceType piece, Move move);
+
+    [[nodiscard]] int getCaptureHistory(const Board &board, Move move) const;
+
+    [[nodiscard]] Move getCounterMove(Move previousMove) const;
+
     int correctEval(int rawEval, const Board &board) const;
 
     void updateQuietHistory(const Board &board, Move move, int bonus);
@@ -44,6 +56,10 @@ public:
 
     void updateContinuationHistory(PieceType piece, Move move, int bonus, int ply, const SearchStack *stack);
 
+    void updateCounterMove(Move previousMove, Move move);
+
+    void updateCaptureHistory(const Board &board, Move move, int bonus);
+
     void resetHistories();
 };
 
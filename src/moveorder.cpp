@@ -23,54 +23,199 @@
 
 DEFINE_PARAM(mvaLvvMultiplyer, 103, 83, 123);
 
-void MoveOrder::orderMoves(const History *history, Movelist &moveList, const Hash *entry, const Move &killer,
-                           const SearchStack *stack, const Board &board, int *scores, const int &ply) {
-    const bool isNullptr = entry == nullptr;
-    const std::uint64_t key = board.zobrist();
+MovePicker::MovePicker(const Board &position, const History &histories, const SearchStack *searchStack,
+                       const int searchPly, const Move hashMove, const Move killerMove, const Move counterMove)
+    : board(position), history(histories), stack(searchStack), ply(searchPly), ttMove(hashMove), killer(killerMove),
+      counter(counterMove), stage(Stage::TT_MOVE) {
+}
+
+MovePicker::MovePicker(const Board &position, const History &histories, const Move hashMove)
+    : board(position), history(histories), stack(nullptr), ply(0), ttMove(hashMove), killer(Move::NO_MOVE),
+      counter(Move::NO_MOVE), stage(Stage::QS_TT_MOVE) {
+}
+
+void MovePicker::scoreCaptures(const Movelist &moveList) {
+    for (const Move &move: moveList) {
+        // The captured pawn of an en passant move isn't on the target square
+        const PieceType captured = move.typeOf() == Move::ENPASSANT
+                                       ? PieceType(PieceType::PAWN)
+                                       : board.at<PieceType>(move.to());
+        const PieceType capturing = board.at<PieceType>(move.from());
+
+        // MVA - LVV, moves capturing the same piece are ordered by their capture history
+        moves[end++] = {
+            move, mvaLvvMultiplyer * (*PIECE_VALUES[captured]) - (*PIECE_VALUES[capturing]) +
+                  history.getCaptureHistory(board, move) / 4
+        };
+    }
+}
+
+void MovePicker::scoreQuiets(const Movelist &moveList) {
+    for (const Move &move: moveList) {
+        const PieceType piece = board.at<PieceType>(move.from());
+        moves[end++] = {
+            move, history.getQuietHistory(board, move) + history.getContinuationHistory(piece, move, ply, stack)
+        };
+    }
+}
+
+const ScoredMove &MovePicker::pickBest() {
+    int best = current;
+    for (int i = current + 1; i < end; i++) {
+        if (moves[i].score > moves[best].score) {
+            best = i;
+        }
+    }
+
+    std::swap(moves[current], moves[best]);
+    return moves[current];
+}
 
+bool MovePicker::isValidQuiet(const Move move) const {
+    return move != Move::NO_MOVE && move != Move::NULL_MOVE && move != ttMove && !board.isCapture(move) &&
+           move.typeOf() != Move::PROMOTION && board.isPseudoLegal(move);
+}
+
+bool MovePicker::canPromote() const {
+    const Color us = board.sideToMove();
+    return static_cast<bool>(board.pieces(PieceType::PAWN, us) & Rank::rank(Rank::RANK_7, us).bb());
+}
 
-    for (int i = 0; i < moveList.size(); i++) {
-        Move move = moveList[i];
-        const bool isCapture = board.isCapture(move);
+Move MovePicker::nextMove() {
+    switch (stage) {
+        case Stage::TT_MOVE:
+            stage = Stage::GENERATE_CAPTURES;
 
-        if (!isNullptr) {
-            if (entry->key == key && move == entry->move) {
-                scores[i] = hashMoveScore;
-                continue;
+            // The TT move is often enough for a cutoff, so we try it before generating anything
+            if (ttMove != Move::NO_MOVE && ttMove != Move::NULL_MOVE && board.isPseudoLegal(ttMove)) {
+                return ttMove;
             }
+            [[fallthrough]];
+
+        case Stage::GENERATE_CAPTURES: {
+            Movelist moveList;
+            movegen::pseudoLegalMoves<movegen::MoveGenType::CAPTURE>(moveList, board);
+            scoreCaptures(moveList);
+
+            stage = Stage::GOOD_CAPTURES;
+            [[fallthrough]];
         }
-        if (isCapture) {
-            const PieceType captured = board.at<PieceType>(move.to());
-            const PieceType capturing = board.at<PieceType>(move.from());
-
-            int captureScore = SEE::see(board, move, 0) ? goodCapture : badCapture;
-
-            // MVA - LVV
-            captureScore += mvaLvvMultiplyer * (*PIECE_VALUES[captured]) - (*PIECE_VALUES[capturing]);
-
-            scores[i] = captureScore;
-        } else if (move == killer && killer != Move::NULL_MOVE) {
-            scores[i] = killerScore;
-        } else {
-            scores[i] += history->getQuietHistory(board, move);
-            if ( move != Move::PROMOTION && move != Move::CASTLING && move != Move::ENPASSANT) {
-                if (board.at(move.from()).type() == PieceType::NONE) {
-                    std::cout << uci::moveToUci(move) << std::endl;
-                    std::cout << board << std::endl;
-                    std::cout << board.getFen() << std::endl;
+
+        case Stage::GOOD_CAPTURES:
+            while (current < end) {
+                const ScoredMove scoredMove = pickBest();
+                current++;
+
+                if (scoredMove.move == ttMove) {
+                    continue;
+                }
+
+                // SEE is only computed for the captures we reach. Losing captures are tried last
+                if (!SEE::see(board, scoredMove.move, 0)) {
+                    moves[badCaptureEnd++] = scoredMove;
+                    continue;
+                }
+
+                return scoredMove.move;
+            }
+
+            stage = Stage::KILLER;
+            [[fallthrough]];
+
+        case Stage::KILLER:
+            stage = Stage::COUNTER;
+
+            if (!skipQuiets && isValidQuiet(killer)) {
+                return killer;
+            }
+            [[fallthrough]];
+
+        case Stage::COUNTER:
+            stage = Stage::GENERATE_QUIETS;
+
+            if (!skipQuiets && counter != killer && isValidQuiet(counter)) {
+                return counter;
+            }
+            [[fallthrough]];
+
+        case Stage::GENERATE_QUIETS:
+            // Promotions aren't quiet moves for the search, so they are generated even if the quiets are skipped
+            if (!skipQuiets || canPromote()) {
+                Movelist moveList;
+                movegen::pseudoLegalMoves<movegen::MoveGenType::QUIET>(moveList, board);
+                scoreQuiets(moveList);
+            }
+
+            stage = Stage::QUIETS;
+            [[fallthrough]];
+
+        case Stage::QUIETS:
+            while (current < end) {
+                // Once the quiets are skipped only the promotions are left, so they don't need to be sorted
+                const Move move = skipQuiets ? moves[current].move : pickBest().move;
+                current++;
+
+                if (move == ttMove || move == killer || move == counter) {
+                    continue;
+                }
+
+                if (skipQuiets && move.typeOf() != Move::PROMOTION) {
+                    continue;
                 }
-                scores[i] += history->getContinuationHistory(board.at(move.from()).type(), move, ply, stack);
+
+                return move;
+            }
+
+            stage = Stage::BAD_CAPTURES;
+            current = 0;
+            [[fallthrough]];
+
+        case Stage::BAD_CAPTURES:
+            if (current < badCaptureEnd) {
+                return moves[current++].move;
             }
+
+            stage = Stage::DONE;
+            [[fallthrough]];
+
+        case Stage::DONE:
+            break;
+
+        case Stage::QS_TT_MOVE:
+            stage = Stage::QS_GENERATE_CAPTURES;
+
+            if (ttMove != Move::NO_MOVE && ttMove != Move::NULL_MOVE && board.isCapture(ttMove) &&
+                board.isPseudoLegal(ttMove)) {
+                return ttMove;
+            }
+            [[fallthrough]];
+
+        case Stage::QS_GENERATE_CAPTURES: {
+            Movelist moveList;
+            movegen::pseudoLegalMoves<movegen::MoveGenType::CAPTURE>(moveList, board);
+            scoreCaptures(moveList);
+
+            stage = Stage::QS_CAPTURES;
+            [[fallthrough]];
         }
+
+        case Stage::QS_CAPTURES:
+            while (current < end) {
+                const Move move = pickBest().move;
+                current++;
+
+                if (move != ttMove) {
+                    return move;
+                }
+            }
+
+            stage = Stage::DONE;
+            break;
     }
+
+    return Move::NO_MOVE;
 }
 
-Move MoveOrder::sortByScore(Movelist &moveList, int scores[], const int &i) {
-    for (int j = i + 1; j < moveList.size(); j++) {
-        if (scores[j] > scores[i]) {
-            std::swap(moveList[i], moveList[j]);
-            std::swap(scores[i], scores[j]);
-        }
-    }
-    return moveList[i];
+void MovePicker::skipQuietMoves() {
+    skipQuiets = true;
 }
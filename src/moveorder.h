@@ -21,15 +21,79 @@
 #define MOVEORDER_H
 
 #include "search_fwd.h"
-#include "tt.h"
 #include "history.h"
 
-class MoveOrder {
+// A move together with its ordering score
+struct ScoredMove {
+    Move move;
+    int score;
+};
+
+// Hands out the moves of a position one at a time in stages. Every stage is only
+// generated and scored once it is reached, so a cutoff saves all the remaining work.
+class MovePicker {
+    enum class Stage : std::uint8_t {
+        TT_MOVE,
+        GENERATE_CAPTURES,
+        GOOD_CAPTURES,
+        KILLER,
+        COUNTER,
+        GENERATE_QUIETS,
+        QUIETS,
+        BAD_CAPTURES,
+        DONE,
+
+        // Quiescence search only looks at captures and leaves SEE to the search
+        QS_TT_MOVE,
+        QS_GENERATE_CAPTURES,
+        QS_CAPTURES
+    };
+
+    const Board &board;
+    const History &history;
+    const SearchStack *stack;
+    const int ply;
+
+    const Move ttMove;
+    const Move killer;
+    const Move counter;
+
+    Stage stage;
+    bool skipQuiets = false;
+
+    // Good captures are consumed from the front, losing captures are moved to the
+    // beginning of the array and the quiets are stored behind the captures
+    ScoredMove moves[MAX_MOVES];
+    int current = 0;
+    int end = 0;
+    int badCaptureEnd = 0;
+
+    void scoreCaptures(const Movelist &moveList);
+    void scoreQuiets(const Movelist &moveList);
+
+    // Moves the best scored move in [current, end) to the current position
+    [[nodiscard]] const ScoredMove &pickBest();
+
+    // Killer and counter moves come from other positions, so they have to be quiet and pseudo legal here
+    [[nodiscard]] bool isValidQuiet(Move move) const;
+
+    // Whether a pawn stands on the seventh rank, only then the quiet moves contain promotions
+    [[nodiscard]] bool canPromote() const;
+
 public:
-    static void orderMoves(const History *history, Movelist &moveList, const Hash *entry, const Move &killer,
-                           const SearchStack *stack, const Board &board, int *scores, const int &ply);
+    MovePicker(const Board &position, const History &histories, const SearchStack *searchStack, int searchPly,
+               Move hashMove, Move killerMove, Move counterMove);
+
+    // Capture picker for the quiescence search
+    MovePicker(const Board &position, const History &histories, Move hashMove);
+
+    // Returns the next move to try or Move::NO_MOVE when all moves were handed out.
+    // The moves are only pseudo legal, so the caller still has to check the legality.
+    [[nodiscard]] Move nextMove();
 
-    static Move sortByScore(Movelist &moveList, int scores[], const int &i);
+    // Skips the killer, counter and quiet moves, e.g. once late move pruning would skip all quiets anyway.
+    // Promotions without a capture are still handed out, the search doesn't prune them
+    void skipQuietMoves();
 };
 
 #endif
@@ -0,0 +1,220 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "perft.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct PerftPosition {
+    const char *fen;
+    int depth;
+    std::uint64_t nodes;
+};
+
+// The usual perft positions from the chess programming wiki
+constexpr PerftPosition perftSuite[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 7, 178633661},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551},
+};
+
+PerftHash::PerftHash(const std::uint32_t sizeInMB) {
+    // Round down to a power of two, so we can index with a mask
+    std::uint64_t count = static_cast<std::uint64_t>(sizeInMB) * 1024 * 1024 / sizeof(Entry);
+    while (count & (count - 1)) {
+        count &= count - 1;
+    }
+
+    if (count > 0) {
+        entries = std::make_unique<Entry[]>(count);
+        mask = count - 1;
+    }
+}
+
+bool PerftHash::probe(const std::uint64_t hash, const int depth, std::uint64_t &nodes) const {
+    const Entry &entry = entries[hash & mask];
+    const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+
+    // The lowest byte holds the depth, the rest the node count
+    if ((entry.key.load(std::memory_order_relaxed) ^ data) != hash || (data & 0xFF) != static_cast<std::uint64_t>(depth)) {
+        return false;
+    }
+
+    nodes = data >> 8;
+    return true;
+}
+
+void PerftHash::store(const std::uint64_t hash, const int depth, const std::uint64_t nodes) const {
+    Entry &entry = entries[hash & mask];
+    const std::uint64_t data = nodes << 8 | static_cast<std::uint64_t>(depth);
+
+    entry.key.store(hash ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+std::uint64_t Perft::perft(Board &board, const int depth, const PerftHash *hash) {
+    Movelist moveList;
+    movegen::legalmoves(moveList, board);
+
+    // Bulk counting, we don't need to make the moves of the last ply
+    if (depth <= 1) {
+        return depth == 1 ? moveList.size() : 1;
+    }
+
+    std::uint64_t nodes = 0;
+    if (hash != nullptr && hash->probe(board.hash(), depth, nodes)) {
+        return nodes;
+    }
+
+    for (const Move &move: moveList) {
+        board.makeMove(move);
+        nodes += perft(board, depth - 1, hash);
+        board.unmakeMove(move);
+    }
+
+    if (hash != nullptr) {
+        hash->store(board.hash(), depth, nodes);
+    }
+
+    return nodes;
+}
+
+std::uint64_t Perft::run(const Board &board, const int depth, const int threads, const std::uint32_t hashSize,
+                         const bool divide) {
+    Movelist rootMoves;
+    movegen::legalmoves(rootMoves, board);
+
+    if (depth <= 1) {
+        if (divide) {
+            for (const Move &move: rootMoves) {
+                std::cout << uci::moveToUci(move) << ": " << (depth == 1 ? 1 : 0) << "\n";
+            }
+        }
+        return depth == 1 ? rootMoves.size() : 1;
+    }
+
+    const std::unique_ptr<PerftHash> hash = hashSize > 0 ? std::make_unique<PerftHash>(hashSize) : nullptr;
+    std::vector<std::uint64_t> counts(rootMoves.size(), 0);
+    std::atomic<int> nextMove(0);
+
+    // Every thread grabs the next unsearched root move until none are left
+    auto worker = [&] {
+        // The perft boards have no network, so we don't update any accumulator
+        Board threadBoard(nullptr, board.getFen());
+        for (int i = nextMove++; i < rootMoves.size(); i = nextMove++) {
+            threadBoard.makeMove(rootMoves[i]);
+            counts[i] = perft(threadBoard, depth - 1, hash.get());
+            threadBoard.unmakeMove(rootMoves[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+
+    for (std::thread &t: workers) {
+        t.join();
+    }
+
+    std::uint64_t nodes = 0;
+    for (int i = 0; i < rootMoves.size(); i++) {
+        if (divide) {
+            std::cout << uci::moveToUci(rootMoves[i]) << ": " << counts[i] << "\n";
+        }
+        nodes += counts[i];
+    }
+
+    return nodes;
+}
+
+void Perft::runSuite(const int threads, const std::uint32_t hashSize) {
+    std::uint64_t totalNodes = 0;
+    double totalTime = 0;
+    bool allPassed = true;
+
+    for (const auto &[fen, depth, expected]: perftSuite) {
+        const Board board(nullptr, fen);
+
+        const std::chrono::time_point start = std::chrono::steady_clock::now();
+        const std::uint64_t nodes = run(board, depth, threads, hashSize, false);
+        const std::chrono::duration<double, std::milli> timeElapsed = std::chrono::steady_clock::now() - start;
+
+        totalNodes += nodes;
+        totalTime += timeElapsed.count();
+        allPassed &= nodes == expected;
+
+        std::cout << (nodes == expected ? "OK    " : "FAILED") << " depth " << depth << " nodes " << nodes
+                << " expected " << expected << " " << std::fixed << std::setprecision(2)
+                << nodes / timeElapsed.count() / 1000 << " Mnps  " << fen << std::endl;
+    }
+
+    std::cout << "Time  : " << static_cast<int>(totalTime) << " ms\nNodes : " << totalNodes << "\nMnps  : "
+            << std::fixed << std::setprecision(2) << totalNodes / totalTime / 1000 << "\n"
+            << (allPassed ? "All perft tests passed" : "Some perft tests failed") << std::endl;
+}
+
+void Perft::handlePerft(const Board &board, std::istringstream &is, const bool divide) {
+    std::string token;
+    int depth = 1;
+    int threads = 1;
+    std::uint32_t hashSize = 0;
+    bool suite = false;
+
+    while (is >> token) {
+        if (token == "suite") {
+            suite = true;
+        } else if (token == "threads") {
+            is >> threads;
+        } else if (token == "hash") {
+            is >> hashSize;
+        } else {
+            try {
+                depth = std::stoi(token);
+            } catch ([[maybe_unused]] const std::exception &e) {
+                std::cerr << "Invalid perft depth: '" << token << "'!" << std::endl;
+                std::cerr << "Usage: perft|divide [depth] [threads N] [hash MB] | perft suite" << std::endl;
+                return;
+            }
+        }
+    }
+
+    threads = std::max(threads, 1);
+
+    if (suite) {
+        runSuite(threads, hashSize);
+        return;
+    }
+
+    const std::chrono::time_point start = std::chrono::steady_clock::now();
+    const std::uint64_t nodes = run(board, depth, threads, hashSize, divide);
+    const std::chrono::duration<double, std::milli> timeElapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "\nTime  : " << static_cast<int>(timeElapsed.count()) << " ms\nNodes : " << nodes << "\nMnps  : "
+            << std::fixed << std::setprecision(2) << nodes / std::max(timeElapsed.count(), 1.0) / 1000 << std::endl;
+}
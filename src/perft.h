@@ -0,0 +1,66 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "chess.hpp"
+using namespace chess;
+
+// Shared table of already counted subtrees. Entries are written without locks,
+// the key is xored with the data so torn entries from other threads never match.
+class PerftHash {
+    struct Entry {
+        std::atomic<std::uint64_t> key;
+        std::atomic<std::uint64_t> data;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    std::uint64_t mask = 0;
+
+public:
+    explicit PerftHash(std::uint32_t sizeInMB);
+
+    [[nodiscard]] bool probe(std::uint64_t hash, int depth, std::uint64_t &nodes) const;
+
+    void store(std::uint64_t hash, int depth, std::uint64_t nodes) const;
+};
+
+class Perft {
+public:
+    // Counts the leaf nodes of the legal move tree. The last ply is bulk counted
+    static std::uint64_t perft(Board &board, int depth, const PerftHash *hash);
+
+    // Splits the root moves across the given amount of threads and prints the count
+    // of every root move if divide is set
+    static std::uint64_t run(const Board &board, int depth, int threads, std::uint32_t hashSize, bool divide);
+
+    // Runs the standard perft positions and checks them against the known counts
+    static void runSuite(int threads, std::uint32_t hashSize);
+
+    // Handles 'perft <depth> [threads <n>] [hash <mb>]', 'perft suite' and 'divide <depth>'
+    static void handlePerft(const Board &board, std::istringstream &is, bool divide);
+};
+
+#endif
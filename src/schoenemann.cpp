@@ -37,12 +37,13 @@
 #include "tt.h"
 #include "timeman.h"
 #include "see.h"
+#include "perft.h"
+#include "worker.h"
+#include "gamerecord.h"
+#include "shuffle.h"
+#include "evalbatch.h"
 
 
-// Define global shared resources for multithreading
-std::mutex outputFileMutex;
-std::atomic<std::uint64_t> totalPositionsGenerated(0);
-
 int main(int argc, char *argv[]) {
     std::uint32_t transpositionTableSize = 16;
 
@@ -61,7 +62,7 @@ int main(int argc, char *argv[]) {
     std::string token, cmd;
 
     // Reset the board
-    board.setFen(STARTPOS);
+    Helper::resetBoard(board);
 
     // Disable FRC (Fisher-Random-Chess)
     board.set960(false);
@@ -69,18 +70,16 @@ int main(int argc, char *argv[]) {
     // Init the LMR
     search->initLMR();
 
-    transpositionTable.setSize(transpositionTableSize);
     timeManagement.reset();
     search->resetHistory();
 
-    std::thread searchThread;
+    // The thread that runs every search started by 'go'
+    SearchWorker worker(*search, board, params);
 
     // Helper function for stoping the search
     auto stopSearch = [&]() {
-        if (searchThread.joinable()) {
-            search->shouldStop = true;
-            searchThread.join();
-        }
+        worker.stopSearch();
+        worker.waitForSearch();
     };
 
     if (argc > 1 && std::strcmp(argv[1], "bench") == 0) {
@@ -88,6 +87,38 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    // Headless datagen, e.g. './Schoenemann datagen threads=8 positions=10000000 seed=1 out=data.bin'
+    if (argc > 1 && std::strcmp(argv[1], "datagen") == 0) {
+        std::string options;
+        for (int i = 2; i < argc; i++) {
+            options += std::string(argv[i]) + " ";
+        }
+
+        std::istringstream is(options);
+        DatagenConfig config;
+        parseDatagenOptions(is, config);
+        runDatagen(config);
+        return 0;
+    }
+
+    // Headless shuffle, e.g. './Schoenemann shuffle in=a.bin,b.bin out=train.txt memory_mb=4096'
+    if (argc > 1 && std::strcmp(argv[1], "shuffle") == 0) {
+        std::string options;
+        for (int i = 2; i < argc; i++) {
+            options += std::string(argv[i]) + " ";
+        }
+
+        std::istringstream is(options);
+        Shuffle::handleShuffle(is);
+        return 0;
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "perft") == 0) {
+        std::istringstream is("suite");
+        Perft::handlePerft(board, is, false);
+        return 0;
+    }
+
     // Main UCI-Loop
     do {
         if (argc == 1 && !std::getline(std::cin, cmd)) {
@@ -108,13 +139,14 @@ int main(int argc, char *argv[]) {
 #endif
             std::cout << "uciok" << std::endl;
         } else if (token == "stop") {
-            stopSearch();
+            // The worker prints the best move, so we don't have to wait for it
+            worker.stopSearch();
         } else if (token == "isready") {
             std::cout << "readyok" << std::endl;
         } else if (token == "ucinewgame") {
             stopSearch();
             // Reset the board
-            board.setFen(STARTPOS);
+            Helper::resetBoard(board);
 
             // Clear the transposition table
             transpositionTable.clear();
@@ -151,104 +183,70 @@ int main(int argc, char *argv[]) {
                         transpositionTable.clear();
                         transpositionTable.setSize(transpositionTableSize);
                     }
+                } else if (token == "MultiPV") {
+                    is >> token;
+                    if (token == "value") {
+                        is >> token;
+                        search->multiPv = std::clamp(std::stoi(token), 1, MAX_MOVES);
+                    }
                 }
             }
         } else if (token == "position") {
             stopSearch();
-            Helper::handleSetPosition(board, is, token);
+            Helper::handleSetPosition(board, is);
         } else if (token == "go") {
             // Stop search
             stopSearch();
-            search->shouldStop = false;
 
             Helper::handleGo(*search, timeManagement, board, is, params);
-            searchThread = std::thread([&] {
-                search->iterativeDeepening(board, params);
-            });
+            worker.startSearch();
+        } else if (token == "ponderhit") {
+            // The opponent played the expected move, so the ponder search continues as a normal timed search
+            search->pondering = false;
         } else if (token == "d") {
             std::cout << board << std::endl;
         } else if (token == "fen") {
             std::cout << board.getFen() << std::endl;
         } else if (token == "datagen") {
-            int numThreads;
-            std::uint64_t positionAmount;
-
-            std::cout << "Enter the number of threads to use (press Enter to use half of the available threads): ";
-            std::string threadInput;
-            std::getline(std::cin, threadInput);
-
-            if (threadInput.empty()) {
-                numThreads = std::max(1u, std::thread::hardware_concurrency() / 2);
-            } else {
-                try {
-                    numThreads = std::stoi(threadInput);
-                } catch ([[maybe_unused]] const std::invalid_argument &ia) {
-                    std::cerr << "Invalid number of threads. Using half of the available threads." << std::endl;
-                    numThreads = std::max(1u, std::thread::hardware_concurrency() / 2);
+            DatagenConfig config;
+
+            // Without 'threads=N positions=M seed=S out=path' the settings are asked for interactively
+            if (!parseDatagenOptions(is, config)) {
+                std::cout << "Enter the number of threads to use (press Enter to use half of the available threads): ";
+                std::string threadInput;
+                std::getline(std::cin, threadInput);
+
+                if (threadInput.empty()) {
+                    config.threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+                } else {
+                    try {
+                        config.threads = std::stoi(threadInput);
+                    } catch ([[maybe_unused]] const std::invalid_argument &ia) {
+                        std::cerr << "Invalid number of threads. Using half of the available threads." << std::endl;
+                        config.threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+                    }
                 }
-            }
-
-            std::cout << "Enter the number of positions to generate: ";
-            std::cin >> positionAmount;
-            // Consume the rest of the line
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Starting datagen with " << numThreads << " threads." << std::endl;
-
-            // Open the output file once in append mode
-            std::ofstream outputFile("output.txt", std::ios::app);
-            if (!outputFile.is_open()) {
-                std::cerr << "Error opening output file for datagen!" << std::endl;
-                return 1;
-            }
 
-            std::vector<std::thread> threads;
-            for (int i = 0; i < numThreads; ++i) {
-                // Launch each thread to run the 'generate' function
-                threads.emplace_back(generate, i, std::ref(outputFile), positionAmount);
+                std::cout << "Enter the number of positions to generate: ";
+                std::cin >> config.positions;
+                // Consume the rest of the line
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
             }
 
-            // Periodically print statistics from the main thread
-            auto startTime = std::chrono::steady_clock::now();
-            while (totalPositionsGenerated < positionAmount) {
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-                auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(
-                    std::chrono::steady_clock::now() - startTime).count();
-                if (elapsedTime > 0) {
-                    // Use .load() for safe reading of atomic variable
-                    auto currentPositions = totalPositionsGenerated.load();
-                    double pps = static_cast<double>(currentPositions) / elapsedTime;
-
-                    // Ensure ETA is never negative
-                    double eta = (pps > 0 && currentPositions < positionAmount)
-                                     ? (positionAmount - currentPositions) / pps
-                                     : 0.0;
-
-                    // Cap displayed progress at 100%
-                    double progress = std::min(100.0, static_cast<double>(currentPositions) / positionAmount * 100.0);
-
-                    std::cout << "\r" << std::fixed << std::setprecision(2)
-                            << "Progress: " << progress << "% | "
-                            << "Positions: " << currentPositions << "/" << positionAmount << " | "
-                            << "PPS: " << static_cast<int>(pps) << " | "
-                            << "ETA: " << static_cast<int>(eta) << "s   " << std::flush;
-                }
-            }
-
-            // Print the progress bar
-            std::cout << "\r" << std::fixed << std::setprecision(2)
-                    << "Progress: " << 100.00 << "% | "
-                    << "Positions: " << positionAmount << "/" << positionAmount << " | "
-                    << "PPS: " << 0 << " | "
-                    << "ETA: " << 0 << "s   " << std::endl;
-
-
-            // The program will run indefinitely; this join part is for graceful shutdown logic
-            for (std::thread &t: threads) {
-                if (t.joinable()) {
-                    t.join();
-                }
-            }
-            outputFile.close();
+            runDatagen(config);
+        } else if (token == "convert") {
+            // Turns binary game records into 'FEN | score | result' lines
+            std::string inputPath, outputPath;
+            is >> inputPath >> outputPath;
+            const std::uint64_t positions = GameReader::convertToText(inputPath, outputPath);
+            std::cout << "Converted " << positions << " positions" << std::endl;
+        } else if (token == "evalbatch") {
+            EvalBatch::handleEvalBatch(is);
+        } else if (token == "shuffle") {
+            Shuffle::handleShuffle(is);
+        } else if (token == "perft" || token == "divide") {
+            stopSearch();
+            Perft::handlePerft(board, is, token == "divide");
         } else if (token == "bench") {
             Helper::runBenchmark(search.get(), board, params);
         } else if (token == "eval") {
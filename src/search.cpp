@@ -21,6 +21,8 @@
 #include <chrono>
 #include <cassert>
 #include <memory>
+#include <algorithm>
+#include <thread>
 
 #include "search.h"
 #include "see.h"
@@ -30,27 +32,69 @@
 DEFINE_PARAM(lmrBase, 80, 50, 105);
 DEFINE_PARAM(lmrDivisor, 250, 200, 280);
 
+// Natural logarithm for x >= 1 that can be evaluated at compile time
+constexpr double constexprLog(double x) {
+    // Scale x into [1, 2) so that the series below converges fast
+    int exponent = 0;
+    while (x >= 2.0) {
+        x /= 2.0;
+        exponent++;
+    }
+
+    // ln(x) = 2 * atanh((x - 1) / (x + 1))
+    const double y = (x - 1.0) / (x + 1.0);
+    double term = y;
+    double sum = 0.0;
+    for (int n = 1; n < 64; n += 2) {
+        sum += term / n;
+        term *= y * y;
+    }
+
+    return 2.0 * sum + exponent * 0.693147180559945309417;
+}
+
+constexpr ReductionTable computeReductions(const int base, const int divisor) {
+    const double lmrBaseFinal = base / 100.0;
+    const double lmrDivisorFinal = divisor / 100.0;
+
+    ReductionTable table{};
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+        for (int moveCount = 1; moveCount < MAX_MOVES; moveCount++) {
+            table[depth][moveCount] = static_cast<std::uint8_t>(std::clamp(
+                lmrBaseFinal + constexprLog(depth) * constexprLog(moveCount) / lmrDivisorFinal, 0.0, 255.0));
+        }
+    }
+    return table;
+}
+
+#ifndef DO_TUNING
+// Without tuning the LMR parameters are constants, so the compiler builds the table
+constexpr ReductionTable reductions = computeReductions(lmrBase, lmrDivisor);
+#endif
+
+template<NodeType nodeType>
 int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, bool cutNode) {
+    // Setup some search constants
+    constexpr bool root = nodeType == NodeType::ROOT;
+    constexpr bool pvNode = nodeType != NodeType::NON_PV;
+    constexpr NodeType childType = pvNode ? NodeType::PV : NodeType::NON_PV;
+
     assert(-EVAL_INFINITE <= alpha && alpha < beta && beta <= EVAL_INFINITE);
+    assert(pvNode || beta == alpha + 1);
+    assert(root == (ply == 0));
 
-    // Setup some search constants
     nodes++;
 
-    const bool root = ply == 0;
-    const bool pvNode = beta > alpha + 1;
-
-    if (pvNode) {
-        stack[ply].pvLength = 0;
+    if constexpr (pvNode) {
+        pvTable.clear(ply);
     }
 
     // We check for a timeout
-    if (timeManagement.shouldStopSoft(start) || nodes >= nodeLimit) {
-        shouldStop = true;
-    }
+    checkLimits();
 
     // If depth is 0 we drop into qs to get a neutral position
     if (depth <= 0) {
-        return qs(alpha, beta, board, ply);
+        return qs<childType>(alpha, beta, board, ply);
     }
 
     // Make sure that depth is always lower than MAX_PLY
@@ -62,7 +106,17 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
         return ply >= MAX_PLY - 1 && !board.inCheck() ? evaluate(board) : 0;
     }
 
-    const bool isSingularSearch = stack[ply].excludedMove != Move::NULL_MOVE;
+    // Upcoming repetition detection
+    // If we can force a repetition with our next move, the position is at least a draw
+    if (!root && alpha < 0 && board.hasUpcomingRepetition(ply)) {
+        alpha = 0;
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
+    // Singular searches use a zero window, so they never happen in PV nodes
+    const bool isSingularSearch = !pvNode && stack[ply].excludedMove != Move::NULL_MOVE;
 
     // Transposition Table lookup
     const Hash *entry = transpositionTable.getHash(board.hash());
@@ -132,7 +186,7 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
 
     // Razoring
     if (!isSingularSearch && !pvNode && !inCheck && depth < 3 && staticEval + 175 * depth < alpha) {
-        if (const int score = qs(alpha, beta, board, ply); score < alpha) {
+        if (const int score = qs<NodeType::NON_PV>(alpha, beta, board, ply); score < alpha) {
             return score;
         }
     }
@@ -143,11 +197,11 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     // For more information please look at docs/nmp.md
     if (!isSingularSearch && !pvNode && depth > 3 && !inCheck && staticEval >= beta) {
         const int nmpDepthReduction = nmpBase + depth / nmpDiv;
-        stack[ply].previousMovedPiece = PieceType::NONE;
+        stack[ply].continuationHistory = nullptr;
         stack[ply].previousMove = Move::NULL_MOVE;
 
         board.makeNullMove();
-        const int score = -pvs(-beta, -beta + 1, depth - nmpDepthReduction, ply + 1, board, !cutNode);
+        const int score = -pvs<NodeType::NON_PV>(-beta, -beta + 1, depth - nmpDepthReduction, ply + 1, board, !cutNode);
         board.unmakeNullMove();
 
         if (score >= beta) {
@@ -162,12 +216,15 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
         depth--;
     }
 
-    Movelist moveList;
-    movegen::legalmoves(moveList, board);
+    // The move picker hands out pseudo legal moves, so we check the legality of the moves we actually search.
+    // In a singular search we still pass the hashed move, so it gets skipped right away
+    const Move ttMove = entry != nullptr && entry->key == board.hash() ? entry->move : Move::NULL_MOVE;
+    const Move previousMove = ply > 0 ? stack[ply - 1].previousMove : Move::NULL_MOVE;
+    const Move counterMove = previousMove != Move::NULL_MOVE && previousMove != Move::NO_MOVE
+                                 ? history.getCounterMove(previousMove)
+                                 : Move::NULL_MOVE;
 
-    int scoreMoves[MAX_MOVES] = {};
-    // Sort the list
-    MoveOrder::orderMoves(&history, moveList, entry, stack[ply].killerMove, stack, board, scoreMoves, ply);
+    MovePicker movePicker(board, history, stack, ply, ttMove, stack[ply].killerMove, counterMove);
 
     // Set up values for the search
     int score = 0;
@@ -176,15 +233,30 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     int quietMoveCount = 0;
     Move bestMoveInPVS = Move::NULL_MOVE;
     Move quietMoves[MAX_MOVES] = {};
+    int captureMoveCount = 0;
+    Move captureMoves[MAX_MOVES] = {};
 
-    for (int i = 0; i < moveList.size(); i++) {
-        const Move move = MoveOrder::sortByScore(moveList, scoreMoves, i);
+    Move move;
+    while ((move = movePicker.nextMove()) != Move::NO_MOVE) {
 
         // We exclude the excluded move from the move loop
         if (move == stack[ply].excludedMove) {
             continue;
         }
 
+        if (!board.isLegal(move)) {
+            continue;
+        }
+
+        int rootIndex = 0;
+        if constexpr (root) {
+            // In MultiPV mode the root moves of the earlier PV slots are already searched
+            rootIndex = findRootMove(move);
+            if (rootIndex < pvIndex) {
+                continue;
+            }
+        }
+
         // We consider a move quiet if it isn't a capture or a promotion
         const bool isQuiet = !board.isCapture(move) && move.typeOf() != Move::PROMOTION;
 
@@ -196,6 +268,8 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             // If we have a quiet position, and we already have made almost
             // all of our moves we skip the move
             if (!pvNode && isQuiet && !inCheck && moveCount >= 4 + 3 * depth * depth) {
+                // The condition holds for every later quiet as well, so we don't even generate them
+                movePicker.skipQuietMoves();
                 continue;
             }
 
@@ -227,7 +301,7 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             const std::uint8_t singularDepth = (depth - seNewDepthSub) / 2;
 
             stack[ply].excludedMove = move;
-            const int singularScore = pvs(singularBeta - 1, singularBeta, singularDepth, ply, board, cutNode);
+            const int singularScore = pvs<NodeType::NON_PV>(singularBeta - 1, singularBeta, singularDepth, ply, board, cutNode);
             stack[ply].excludedMove = Move::NULL_MOVE;
 
             if (singularScore < singularBeta) {
@@ -244,7 +318,10 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             }
         }
 
-        stack[ply].previousMovedPiece = board.at(move.from()).type();
+        // The child probes its entry right away, making the move hides most of the cache miss
+        transpositionTable.prefetch(board.approximateKeyAfter(move));
+
+        stack[ply].continuationHistory = history.getContinuationTable(board.at(move.from()).type(), move);
         stack[ply].previousMove = move;
 
         board.makeMove(move);
@@ -256,12 +333,15 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
         if (isQuiet) {
             quietMoves[quietMoveCount] = move;
             quietMoveCount++;
+        } else {
+            captureMoves[captureMoveCount] = move;
+            captureMoveCount++;
         }
 
         // PVS
         // We assume our first move is the best move so we search this move with a full window
         if (moveCount == 1) {
-            score = -pvs(-beta, -alpha, depth - 1 + extensions, ply + 1, board, !cutNode);
+            score = -pvs<childType>(-beta, -alpha, depth - 1 + extensions, ply + 1, board, !cutNode);
         } else {
             int depthReduction = 0;
 
@@ -287,11 +367,11 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
 
             // Since we assumed that our first move was the best we search every other
             // move with a zero window
-            score = -pvs(-alpha - 1, -alpha, depth - depthReduction - 1 + extensions, ply + 1, board, true);
+            score = -pvs<NodeType::NON_PV>(-alpha - 1, -alpha, depth - depthReduction - 1 + extensions, ply + 1, board, true);
 
             // If the score is outside the window we need to research with full window
             if (score > alpha && (score < beta || depthReduction > 0)) {
-                score = -pvs(-beta, -alpha, depth - 1 + extensions, ply + 1, board, !cutNode);
+                score = -pvs<childType>(-beta, -alpha, depth - 1 + extensions, ply + 1, board, !cutNode);
             }
         }
 
@@ -299,10 +379,15 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
 
         assert(score > -EVAL_INFINITE && score < EVAL_INFINITE);
 
-        if (shouldStop && rootBestMove != Move::NULL_MOVE) {
+        if (shouldStop.load(std::memory_order_relaxed) && rootBestMove != Move::NULL_MOVE) {
             return 0;
         }
 
+        if constexpr (root) {
+            // Moves that don't raise alpha only have an upper bound, so they get sorted behind the best move
+            rootMoveList[rootIndex].score = moveCount == 1 || score > alpha ? score : -EVAL_INFINITE;
+        }
+
         if (score > bestScore) {
             bestScore = score;
             if (score > alpha) {
@@ -310,31 +395,48 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
                 bestMoveInPVS = move;
 
                 // If we are at the root we set the bestMove
-                if (root) {
-                    // Update the score of the root move
-                    for (int x = 0; x < rootMoveListSize; x++) {
-                        if (rootMoveList[x].move == move) {
-                            rootMoveList[x].score = score;
-                            break;
-                        }
+                if constexpr (root) {
+                    if (pvIndex == 0) {
+                        rootBestMove = move;
                     }
-                    rootBestMove = move;
                 }
 
                 // Update the pvLine
-                if (pvNode) {
-                    updatePv(ply, move);
+                if constexpr (pvNode) {
+                    pvTable.update(ply, move);
                 }
             }
 
             // Beta cutoff
             if (score >= beta) {
+                // Capture History
+                // The captures we tried before didn't cause a cutoff, so they get a malus.
+                // Captures use the same bonus and malus as the quiet history
+                const int captureHistoryBonus = std::min(qhBB + qhBM * depth, static_cast<int>(qhBC));
+                const int captureHistoryMalus = std::min(qhMB + qhMM * depth, static_cast<int>(qhMC));
+
+                for (int x = 0; x < captureMoveCount; x++) {
+                    if (captureMoves[x] != move) {
+                        history.updateCaptureHistory(board, captureMoves[x], -captureHistoryMalus);
+                    }
+                }
+
+                if (!isQuiet) {
+                    history.updateCaptureHistory(board, move, captureHistoryBonus);
+                }
+
                 if (isQuiet) {
                     // Killer Move
                     // If the move is quiet but still causes a fail high which is very unusual,
                     // we store the move and later rank it high up in the move ordering
                     stack[ply].killerMove = move;
 
+                    // Counter Move
+                    // We remember the move as the refutation of the move our opponent played before
+                    if (previousMove != Move::NULL_MOVE && previousMove != Move::NO_MOVE) {
+                        history.updateCounterMove(previousMove, move);
+                    }
+
                     // Quiet History
                     const int quietHistoryBonus = std::min(qhBB + qhBM * depth, static_cast<int>(qhBC));
                     const int quietHistoryMalus = std::min(qhMB + qhMM * depth, static_cast<int>(qhMC));
@@ -380,6 +482,12 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     const bool failHigh = bestScore >= beta;
     const bool failLow = alpha == oldAlpha;
     const Bound flag = failHigh ? Bound::LOWER : !failLow ? Bound::EXACT : Bound::UPPER;
+
+    // The later PV slots don't search all root moves, so their result isn't a score of the root position
+    if (root && pvIndex > 0) {
+        return bestScore;
+    }
+
     if (!isSingularSearch) {
         transpositionTable.storeHash(board.hash(), depth, flag, tt::scoreToTT(bestScore, ply), bestMoveInPVS,
                                      rawEval);
@@ -396,20 +504,20 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     return bestScore;
 }
 
+template<NodeType nodeType>
 int Search::qs(int alpha, int beta, Board &board, const int ply) {
+    constexpr bool pvNode = nodeType != NodeType::NON_PV;
+
     assert(alpha >= -EVAL_INFINITE && alpha < beta && beta <= EVAL_INFINITE);
+    assert(pvNode || beta == alpha + 1);
 
     nodes++;
 
-    const bool pvNode = beta > alpha + 1;
-
-    if (pvNode) {
-        stack[ply].pvLength = 0;
+    if constexpr (pvNode) {
+        pvTable.clear(ply);
     }
 
-    if (timeManagement.shouldStopSoft(start) || nodes >= nodeLimit) {
-        shouldStop = true;
-    }
+    checkLimits();
 
     if (shouldExit(board, ply)) {
         return ply >= MAX_PLY - 1 && !board.inCheck() ? evaluate(board) : 0;
@@ -463,29 +571,57 @@ int Search::qs(int alpha, int beta, Board &board, const int ply) {
         bestScore = -EVAL_INFINITE;
     }
 
-    Movelist moveList;
-    movegen::legalmoves<movegen::MoveGenType::CAPTURE>(moveList, board);
+    // The captures are ordered by MVV-LVA and capture history
+    MovePicker movePicker(board, history, ttHit ? entry->move : Move::NULL_MOVE);
 
     Move bestMoveInQs = Move::NULL_MOVE;
     int moveCount = 0;
     const bool isSingularSearch = stack[ply].excludedMove != Move::NULL_MOVE;
 
-    for (const Move &move: moveList) {
+    // If our static eval plus this margin is below alpha, a capture has to win material to raise alpha
+    const int futilityBase = staticEval + qsFpMargin;
+
+    Move move;
+    while ((move = movePicker.nextMove()) != Move::NO_MOVE) {
+        if (!inCheck && move.typeOf() != Move::PROMOTION) {
+            // Delta Pruning
+            // Even if we win the captured piece for free, we don't get close to alpha
+            const PieceType captured = move.typeOf() == Move::ENPASSANT
+                                           ? PieceType(PieceType::PAWN)
+                                           : board.at<PieceType>(move.to());
+            if (const int futilityValue = futilityBase + *SEE_PIECE_VALUES[captured]; futilityValue <= alpha) {
+                bestScore = std::max(bestScore, futilityValue);
+                continue;
+            }
+        }
+
         // Static Exchange evaluation (SEE)
         // We look at a move if it returns a negative result form SEE.
         // That means when the result is positive the opponent is winning the exchange on
-        // the target square of the move.
-        if (!SEE::see(board, move, 0)) {
+        // the target square of the move. SEE only runs for moves that survived the pruning above.
+        // Futility Pruning: if we are far below alpha, the capture has to win material
+        const bool futile = !inCheck && futilityBase <= alpha;
+        if (!SEE::see(board, move, futile ? 1 : 0)) {
+            if (futile) {
+                bestScore = std::max(bestScore, futilityBase);
+            }
+            continue;
+        }
+
+        if (!board.isLegal(move)) {
             continue;
         }
 
-        stack[ply].previousMovedPiece = board.at(move.from()).type();
+        // The child probes its entry right away, making the move hides most of the cache miss
+        transpositionTable.prefetch(board.approximateKeyAfter(move));
+
+        stack[ply].continuationHistory = history.getContinuationTable(board.at(move.from()).type(), move);
         stack[ply].previousMove = move;
 
         board.makeMove(move);
         moveCount++;
 
-        const int score = -qs(-beta, -alpha, board, ply + 1);
+        const int score = -qs<nodeType>(-beta, -alpha, board, ply + 1);
         assert(score < EVAL_INFINITE && score > -EVAL_INFINITE);
 
         board.unmakeMove(move);
@@ -499,8 +635,8 @@ int Search::qs(int alpha, int beta, Board &board, const int ply) {
                 alpha = score;
 
                 // Update pvLine
-                if (pvNode) {
-                    updatePv(ply, move);
+                if constexpr (pvNode) {
+                    pvTable.update(ply, move);
                 }
 
                 bestMoveInQs = move;
@@ -549,20 +685,28 @@ void Search::iterativeDeepening(Board &board, const SearchParams &params) {
     Movelist moveList;
     movegen::legalmoves(moveList, board);
 
-    // Initialize the rootMoveList
-    rootMoveList = std::make_unique<RootMove[]>(moveList.size());
-
     // Fill every move into the rootMoveList
     for (int i = 0; i < moveList.size(); i++) {
         rootMoveList[i].move = moveList[i];
+        rootMoveList[i].score = EVAL_NONE;
+        rootMoveList[i].pvLength = 0;
     }
 
     // We keep track of the size
     rootMoveListSize = moveList.size();
+
+    // Without a legal move there is nothing to search, but the GUI still expects the score of the position
+    if (rootMoveListSize == 0) {
+        currentScore = board.inCheck() ? matedIn(0) : 0;
+        if (!params.minimal) {
+            std::cout << "info depth 0" << scoreToUci(currentScore) << std::endl;
+        }
+    }
+
     const int finalDepth = params.depth == MAX_PLY ? MAX_PLY : params.depth + 1;
-    for (int i = 1; i < finalDepth; i++) {
-        if ((timeManagement.shouldStopID(start) && !params.isInfinite) || i == MAX_PLY - 1 || nodes >= nodeLimit ||
-            shouldStop) {
+    for (int i = 1; i < finalDepth && rootMoveListSize > 0; i++) {
+        if ((timeManagement.shouldStopID(start) && !params.isInfinite && !pondering) || i == MAX_PLY - 1 ||
+            nodes >= nodeLimit || shouldStop) {
             break;
         }
 
@@ -570,41 +714,92 @@ void Search::iterativeDeepening(Board &board, const SearchParams &params) {
             previousBestScore = currentScore;
         }
 
-        if (i > 3) {
-            // Set up the initial aspiration window
-            delta = aspBase;
-            alpha = std::max(currentScore - delta, -EVAL_INFINITE);
-            beta = std::min(currentScore + delta, EVAL_INFINITE);
+        // In MultiPV mode we search one PV slot after the other. Every slot searches the root moves
+        // that are not in an earlier slot, so it finds the next best move
+        const int pvCount = std::min(multiPv, rootMoveListSize);
+
+        // The root search of a slot overwrites the scores of the moves behind it,
+        // so the scores of the last iteration are saved for the aspiration windows first
+        std::array<int, MAX_MOVES> previousSlotScores;
+        for (int pv = 0; pv < pvCount; pv++) {
+            previousSlotScores[pv] = rootMoveList[pv].score;
         }
 
-        while (true) {
-            const int newScore = pvs(alpha, beta, i, 0, board, false);
+        for (pvIndex = 0; pvIndex < pvCount && !shouldStop; pvIndex++) {
+            if (i > 3) {
+                // Set up the initial aspiration window
+                const int previousScore = pvIndex == 0 ? currentScore : previousSlotScores[pvIndex];
+                delta = aspBase;
+                alpha = std::max(previousScore - delta, -EVAL_INFINITE);
+                beta = std::min(previousScore + delta, EVAL_INFINITE);
+            } else {
+                alpha = -EVAL_INFINITE;
+                beta = EVAL_INFINITE;
+            }
+
+            while (true) {
+                const int newScore = pvs<NodeType::ROOT>(alpha, beta, i, 0, board, false);
 
-            // Our score did fall inside our bounds so we exit the search
-            if (newScore > alpha && newScore < beta) {
-                currentScore = newScore;
+                // The result of an interrupted search is not a score we can use
+                if (shouldStop) {
+                    break;
+                }
+
+                // Our score did fall inside our bounds so we exit the search
+                if (newScore > alpha && newScore < beta) {
+                    if (pvIndex == 0) {
+                        currentScore = newScore;
+                    }
+                    break;
+                }
+
+                // Fail low
+                if (newScore <= alpha) {
+                    // We narrow beta down to make a fail high more likely
+                    beta = (alpha + beta) / 2;
+
+                    // We make alpha wider to lower the chance of a fail low
+                    alpha = std::max(alpha - delta, -EVAL_INFINITE);
+                }
+
+                // Fail High
+                else {
+                    // We make beta bigger to decrease the chance of another fail high
+                    // Since fail highs on PV nodes are very strange
+                    beta = std::min(beta + delta, EVAL_INFINITE);
+                }
+
+                // We want to widen the window for the next iteration
+                // to increase the chance that our score is inside our bounds
+                delta *= 2;
+            }
+
+            if (shouldStop) {
                 break;
             }
 
-            // Fail low
-            if (newScore <= alpha) {
-                // We narrow beta down to make a fail high more likely
-                beta = (alpha + beta) / 2;
+            // Sort the best move of this slot to the front of the remaining root moves and remember its line
+            sortRootMoves(rootMoveList.data() + pvIndex, rootMoveList.data() + rootMoveListSize);
 
-                // We make alpha wider to lower the chance of a fail low
-                alpha = std::max(alpha - delta, -EVAL_INFINITE);
+            RootMove &rootMove = rootMoveList[pvIndex];
+            rootMove.pvLength = pvTable.length(0);
+            for (int j = 0; j < rootMove.pvLength; j++) {
+                rootMove.pvLine[j] = pvTable.line(0)[j];
             }
 
-            // Fail High
-            else {
-                // We make beta bigger to decrease the chance of another fail high
-                // Since fail highs on PV nodes are very strange
-                beta = std::min(beta + delta, EVAL_INFINITE);
-            }
+            // A later slot can get a better score than an earlier one, so the finished slots are sorted again
+            sortRootMoves(rootMoveList.data(), rootMoveList.data() + pvIndex + 1);
+        }
+
+        if (!shouldStop && pvCount > 0) {
+            rootBestMove = rootMoveList[0].move;
+            currentScore = rootMoveList[0].score;
+        }
 
-            // We want to widen the window for the next iteration
-            // to increase the chance that our score is inside our bounds
-            delta *= 2;
+        // An interrupted iteration can still have found a better move, but we don't report its lines
+        if (shouldStop) {
+            bestMoveThisIteration = rootBestMove;
+            break;
         }
 
         if (i > 6) {
@@ -625,55 +820,58 @@ void Search::iterativeDeepening(Board &board, const SearchParams &params) {
 
         std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
         if (!params.minimal) {
-            std::cout
-                << "info depth " << i
-                << scoreToUci()
-                << " nodes " << nodes
-                << " nps " << static_cast<std::uint64_t>(nodes / (elapsed.count() + 1) * 1000)
-                << " hashfull " << transpositionTable.estimateHashfull()
-                << " time " << static_cast<std::uint64_t>(elapsed.count() + 1)
-                << " pv " << getPVLine()
-                << std::endl;
+            for (int pv = 0; pv < pvCount; pv++) {
+                std::cout << "info depth " << i;
+                if (multiPv > 1) {
+                    std::cout << " multipv " << pv + 1;
+                }
+                std::cout
+                    << scoreToUci(rootMoveList[pv].score)
+                    << " nodes " << nodes
+                    << " nps " << static_cast<std::uint64_t>(nodes / (elapsed.count() + 1) * 1000)
+                    << " hashfull " << transpositionTable.estimateHashfull()
+                    << " time " << static_cast<std::uint64_t>(elapsed.count() + 1)
+                    << " pv " << getPVLine(rootMoveList[pv])
+                    << std::endl;
+            }
         }
 
         // std::cout << "Time for this move: " << timeForMove << " | Time used: " << static_cast<int>(elapsed.count()) << " | Depth: " << i << " | bestmove: " << bestMove << std::endl;
     }
+    // We aren't allowed to send the best move before the GUI ends the ponder search
+    while (pondering && !shouldStop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pondering = false;
+
     if (!params.minimal) {
-        std::cout << "bestmove " << uci::moveToUci(bestMoveThisIteration) << std::endl;
+        // UCI has no move for a position without legal moves, the null move is sent as '0000'
+        std::cout << "bestmove " << (rootMoveListSize == 0 ? "0000" : uci::moveToUci(bestMoveThisIteration));
+
+        if (const Move ponderMove = getPonderMove(board, bestMoveThisIteration); ponderMove != Move::NULL_MOVE) {
+            std::cout << " ponder " << uci::moveToUci(ponderMove);
+        }
+        std::cout << std::endl;
     }
     shouldStop = false;
     nodeLimit = NO_NODE_LIMIT;
 }
 
-std::string Search::scoreToUci() const {
-    int score = EVAL_NONE;
-
-    // Get the score of the best root move
-    for (int i = 0; i < rootMoveListSize; i++) {
-        if (rootMoveList[i].move == rootBestMove) {
-            score = rootMoveList[i].score;
-            break;
-        }
-    }
+std::string Search::scoreToUci(const int score) {
     if (score >= EVAL_MATE_IN_MAX_PLY) {
-        return " mate " + std::to_string((EVAL_MATE - score) / 2 + 1);
+        return " score mate " + std::to_string((EVAL_MATE - score) / 2 + 1);
     }
     if (score <= -EVAL_MATE_IN_MAX_PLY) {
-        return " mate " + std::to_string(-(EVAL_MATE + score) / 2);
+        return " score mate " + std::to_string(-(EVAL_MATE + score) / 2);
     }
     assert(score != EVAL_NONE);
     return " score cp " + std::to_string(score);
 }
 
 void Search::initLMR() {
-    const double lmrBaseFinal = lmrBase / 100.0;
-    const double lmrDivisorFinal = lmrDivisor / 100.0;
-    for (int depth = 1; depth < MAX_PLY; depth++) {
-        for (int moveCount = 1; moveCount < MAX_MOVES; moveCount++) {
-            reductions[depth][moveCount] = static_cast<std::uint8_t>(std::clamp(
-                lmrBaseFinal + std::log(depth) * std::log(moveCount) / lmrDivisorFinal, 0.0, 255.0));
-        }
-    }
+#ifdef DO_TUNING
+    reductions = computeReductions(lmrBase, lmrDivisor);
+#endif
 }
 
 int Search::scaleOutput(const int rawEval, const Board &board) {
@@ -693,30 +891,107 @@ int Search::evaluate(const Board &board) const {
     return std::clamp(scaledEval, -EVAL_MATE, EVAL_MATE);
 }
 
-void Search::updatePv(const int ply, const Move &move) {
-    stack[ply].pvLine[0] = move;
-    stack[ply].pvLength = stack[ply + 1].pvLength + 1;
-    for (int i = 0; i < stack[ply + 1].pvLength; i++) {
-        stack[ply].pvLine[i + 1] = stack[ply + 1].pvLine[i];
+std::string Search::getPVLine(const RootMove &rootMove) {
+    std::string pvLine;
+    for (int i = 0; i < rootMove.pvLength; i++) {
+        pvLine += uci::moveToUci(rootMove.pvLine[i]) + " ";
     }
+    return pvLine;
 }
 
-std::string Search::getPVLine() const {
-    std::string pvLine;
-    for (int i = 0; i < stack[0].pvLength; i++) {
-        pvLine += uci::moveToUci(stack[0].pvLine[i]) + " ";
+Move Search::getPonderMove(Board &board, const Move bestMove) const {
+    if (bestMove == Move::NULL_MOVE) {
+        return Move::NULL_MOVE;
     }
-    return pvLine;
+
+    // The expected reply is the second move of the principal variation
+    if (const int index = findRootMove(bestMove); index < rootMoveListSize) {
+        if (const RootMove &rootMove = rootMoveList[index]; rootMove.pvLength > 1 && rootMove.pvLine[0] == bestMove) {
+            return rootMove.pvLine[1];
+        }
+    }
+
+    // When the best move changed in the last iteration we have no line for it, so we ask the transposition table
+    board.makeMove(bestMove);
+    Move ponderMove = Move::NULL_MOVE;
+    if (const Hash *entry = transpositionTable.getHash(board.hash());
+        entry != nullptr && entry->key == board.hash() && entry->move != Move::NULL_MOVE &&
+        board.isPseudoLegal(entry->move) && board.isLegal(entry->move)) {
+        ponderMove = entry->move;
+    }
+    board.unmakeMove(bestMove);
+
+    return ponderMove;
+}
+
+int Search::findRootMove(const Move move) const {
+    for (int i = 0; i < rootMoveListSize; i++) {
+        if (rootMoveList[i].move == move) {
+            return i;
+        }
+    }
+    return rootMoveListSize;
 }
 
 bool Search::isDraw(const Board &board) {
-    return board.isHalfMoveDraw() || board.isRepetition() || board.isInsufficientMaterial();
+    // The repetition scan is the most expensive check, so it comes last
+    return board.isHalfMoveDraw() || board.isInsufficientMaterial() || board.isRepetition();
 }
 
 bool Search::shouldExit(const Board &board, const int ply) const {
-    return (shouldStop || ply >= MAX_PLY - 1 || isDraw(board)) && rootBestMove != Move::NULL_MOVE;
+    return (shouldStop.load(std::memory_order_relaxed) || ply >= MAX_PLY - 1 || isDraw(board)) &&
+           rootBestMove != Move::NULL_MOVE;
+}
+
+void Search::checkLimits() {
+    // The node limit is cheap to check, so it stays exact
+    if (nodes >= nodeLimit) {
+        shouldStop.store(true, std::memory_order_relaxed);
+    }
+
+    // Reading the clock is expensive compared to a node, so we only do it every few nodes
+    if ((nodes & (TIME_CHECK_INTERVAL - 1)) == 0 && !pondering.load(std::memory_order_relaxed) &&
+        timeManagement.shouldStopSoft(start)) {
+        shouldStop.store(true, std::memory_order_relaxed);
+    }
+}
+
+SearchResult Search::searchPosition(Board &board, const int depth, const std::uint64_t maxNodes) {
+    SearchParams params;
+    params.isInfinite = true;
+    params.depth = depth;
+    params.minimal = true;
+
+    nodeLimit = maxNodes;
+    iterativeDeepening(board, params);
+
+    return {rootBestMove, currentScore, nodes};
+}
+
+void Search::sortRootMoves(RootMove *first, RootMove *last) {
+    // Insertion sort, there are only a few root moves and most of them are already in order
+    for (RootMove *current = first + 1; current < last; current++) {
+        if (current->score <= (current - 1)->score) {
+            continue;
+        }
+
+        RootMove rootMove = *current;
+        RootMove *position = current;
+        for (; position > first && (position - 1)->score < rootMove.score; position--) {
+            *position = *(position - 1);
+        }
+        *position = rootMove;
+    }
+}
+
+void Search::newGame() {
+    transpositionTable.clear();
+    resetHistory();
 }
 
 void Search::resetHistory() {
     history.resetHistories();
+
+    // The killer moves survive between searches, so they belong to the history of the game as well
+    std::fill(std::begin(stack), std::end(stack), SearchStack{});
 }
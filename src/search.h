@@ -24,21 +24,38 @@
 #include "tt.h"
 #include "moveorder.h"
 #include "search_fwd.h"
+#include <array>
 #include <memory>
 #include <limits>
 #include <atomic>
 
+using ReductionTable = std::array<std::array<std::uint8_t, MAX_MOVES>, MAX_PLY>;
+
+// The node type is known when a node is searched, so pvs is compiled once for every type.
+// That way the root and PV only code compiles away in the much more frequent non PV nodes
+enum class NodeType {
+    ROOT,
+    PV,
+    NON_PV
+};
+
 struct alignas(8) SearchParams {
     bool isInfinite = false;
     int depth = MAX_PLY;
     bool minimal = false;
 };
 
+struct SearchResult {
+    Move bestMove = Move::NULL_MOVE;
+    int score = 0;
+    std::uint64_t nodes = 0;
+};
+
 class Search {
 public:
     Search(TimeManagement &timeManagement,
            tt &transpositionTabel,
-           Network &net) : reductions{}, stack{}, timeManagement(timeManagement),
+           Network &net) : stack{}, timeManagement(timeManagement),
                            transpositionTable(transpositionTabel), history(),
                            net(net) {
     }
@@ -48,7 +65,13 @@ public:
 
     std::atomic<bool> shouldStop{false};
 
+    // While we ponder we search on the opponent's time, so the time limits only apply after a ponderhit
+    std::atomic<bool> pondering{false};
+
     std::uint64_t nodeLimit = NO_NODE_LIMIT;
+
+    // How many of the best root moves we search with an exact score
+    int multiPv = 1;
     std::uint64_t nodes = 0;
 
     int timeForMove = 0;
@@ -57,22 +80,39 @@ public:
 
     static constexpr std::uint64_t NO_NODE_LIMIT = std::numeric_limits<std::uint64_t>::max();
 
-    std::uint8_t reductions[MAX_PLY][MAX_MOVES];
+    // How many nodes we search between two checks of the clock. Has to be a power of two
+    static constexpr std::uint64_t TIME_CHECK_INTERVAL = 1024;
+
+#ifdef DO_TUNING
+    // The LMR parameters can change at runtime, so every search needs its own table
+    ReductionTable reductions{};
+#endif
     SearchStack stack[MAX_PLY];
+    PvTable pvTable;
 
     static int scaleOutput(int rawEval, const Board &board);
 
-    [[nodiscard]] std::string scoreToUci() const;
+    [[nodiscard]] static std::string scoreToUci(int score);
     [[nodiscard]] int evaluate(const Board &board) const;
 
+    template<NodeType nodeType>
     int pvs(int alpha, int beta, int depth, int ply, Board &board, bool cutNode);
+
+    template<NodeType nodeType>
     int qs(int alpha, int beta, Board &board, int ply);
 
-    void updatePv(int ply, const Move &move);
     void iterativeDeepening(Board &board, const SearchParams &params);
+
+    // Runs a silent search limited by depth and nodes for tools like datagen that search thousands
+    // of positions. All buffers of the search are reused, so a call does not allocate any memory
+    SearchResult searchPosition(Board &board, int depth, std::uint64_t maxNodes);
+
     void initLMR();
     void resetHistory();
 
+    // Forgets everything learned from earlier positions, the transposition table included
+    void newGame();
+
 private:
     TimeManagement &timeManagement;
     tt &transpositionTable;
@@ -81,15 +121,28 @@ private:
 
     std::chrono::steady_clock::time_point start;
 
-    std::unique_ptr<RootMove[]> rootMoveList;
+    // Sized for every legal position, so no search has to allocate it
+    std::array<RootMove, MAX_MOVES> rootMoveList;
     int rootMoveListSize = 0;
 
+    // The PV slot we are currently searching. Root moves of the earlier slots are skipped
+    int pvIndex = 0;
+
+    [[nodiscard]] int findRootMove(Move move) const;
+
+    [[nodiscard]] Move getPonderMove(Board &board, Move bestMove) const;
+
 
     static bool isDraw(const Board &board);
 
     [[nodiscard]] bool shouldExit(const Board &board, int ply) const;
 
-    [[nodiscard]] std::string getPVLine() const;
+    void checkLimits();
+
+    // A stable sort by score that works in place, unlike std::stable_sort which allocates a buffer
+    static void sortRootMoves(RootMove *first, RootMove *last);
+
+    [[nodiscard]] static std::string getPVLine(const RootMove &rootMove);
 };
 
 #endif
@@ -1,24 +1,71 @@
 #ifndef SEARCH_FWD
 #define SEARCH_FWD
 
+#include <array>
+
 #include "consts.h"
 #include "chess.hpp"
 using namespace chess;
 
-struct alignas(1024) SearchStack {
+// The continuation history of every piece type and target square that can follow one move
+using PieceToHistory = std::int16_t[6][64];
+
+// Only the per ply data the search reads in every node, so neighbouring plies share cache lines
+struct SearchStack {
+    // The continuation history that follows the move made at this ply, nullptr after a null move
+    PieceToHistory *continuationHistory = nullptr; // (8 Byte)
     int staticEval = EVAL_NONE; // (4 Byte)
-    std::uint16_t pvLength = 0; // (2 Byte)
+    Move killerMove = Move::NULL_MOVE; // (2 Byte)
+    Move previousMove = Move::NULL_MOVE; // (2 Byte)
+    Move excludedMove = Move::NULL_MOVE; // (2 Byte)
     bool inCheck = false; // (1 Byte)
-    Move pvLine[MAX_PLY]; // (980 Byte)
-    Move killerMove = Move::NULL_MOVE; // (4 Byte)
-    PieceType previousMovedPiece = PieceType::NONE; // (1 Byte)
-    Move previousMove = Move::NULL_MOVE; // (4 Byte)
-    Move excludedMove = Move::NULL_MOVE; // (4 Byte)
+};
+
+// Stores the principal variation of every ply in one triangular array.
+// A line that starts at ply can have at most MAX_PLY - ply moves, so every line is one move
+// shorter than the line of the ply before and directly follows it in memory
+class PvTable {
+public:
+    void clear(const int ply) {
+        lengths[ply] = 0;
+    }
+
+    // Sets the line of ply to move followed by the line of the child ply
+    void update(const int ply, const Move move) {
+        Move *line = &moves[offset(ply)];
+        const Move *childLine = line + MAX_PLY - ply;
+
+        line[0] = move;
+        for (int i = 0; i < lengths[ply + 1]; i++) {
+            line[i + 1] = childLine[i];
+        }
+        lengths[ply] = lengths[ply + 1] + 1;
+    }
+
+    [[nodiscard]] int length(const int ply) const {
+        return lengths[ply];
+    }
+
+    [[nodiscard]] const Move *line(const int ply) const {
+        return &moves[offset(ply)];
+    }
+
+private:
+    static constexpr int offset(const int ply) {
+        return ply * (2 * MAX_PLY - ply + 1) / 2;
+    }
+
+    std::array<Move, MAX_PLY * (MAX_PLY + 1) / 2> moves{};
+    std::array<std::uint16_t, MAX_PLY + 1> lengths{};
 };
 
 struct alignas(8) RootMove {
     Move move = Move::NULL_MOVE;
     int score = EVAL_NONE;
+
+    // The principal variation that starts with this move, only valid for the moves of a PV slot
+    int pvLength = 0;
+    Move pvLine[MAX_PLY];
 };
 
 #endif
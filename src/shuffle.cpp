@@ -0,0 +1,370 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "shuffle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+void Shuffle::handleShuffle(std::istringstream &is) {
+    ShuffleConfig config;
+    config.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    config.seed = std::random_device{}();
+
+    std::string token;
+    while (is >> token) {
+        const std::size_t separator = token.find('=');
+        const std::string key = token.substr(0, separator);
+        const std::string value = separator == std::string::npos ? "" : token.substr(separator + 1);
+
+        try {
+            if (key == "in") {
+                std::istringstream paths(value);
+                std::string path;
+                while (std::getline(paths, path, ',')) {
+                    if (!path.empty()) config.inputPaths.push_back(path);
+                }
+            } else if (key == "out") {
+                config.outputPath = value;
+            } else if (key == "format") {
+                config.binaryOutput = value == "binary";
+            } else if (key == "threads") {
+                config.threads = std::max(1, std::stoi(value));
+            } else if (key == "memory_mb") {
+                config.memoryMB = std::max<std::uint64_t>(1, std::stoull(value));
+            } else if (key == "seed") {
+                config.seed = std::stoull(value);
+            } else if (key == "max_score") {
+                config.maxScore = std::max(0, std::stoi(value));
+            } else if (key == "results") {
+                config.results = value;
+            } else {
+                std::cerr << "Unknown shuffle option: '" << key << "'!" << std::endl;
+            }
+        } catch ([[maybe_unused]] const std::exception &e) {
+            std::cerr << "Invalid value for shuffle option '" << key << "': '" << value << "'!" << std::endl;
+        }
+    }
+
+    if (config.inputPaths.empty() || config.outputPath.empty()) {
+        std::cerr << "Usage: shuffle in=a.bin,b.bin out=path [format=text|binary] [threads=N] [memory_mb=M] "
+                "[seed=S] [max_score=S] [results=wdl]" << std::endl;
+        return;
+    }
+
+    const std::uint64_t positions = run(config);
+    std::cout << "Shuffled " << positions << " positions into " << config.outputPath << std::endl;
+}
+
+std::string Shuffle::bucketPath(const ShuffleConfig &config, const int inputIndex, const int bucket) {
+    return config.outputPath + ".bucket" + std::to_string(bucket) + "." + std::to_string(inputIndex);
+}
+
+// Every step of the shuffle draws from its own generator. The seed is split into halves,
+// because std::seed_seq only keeps the lower 32 bits of every value
+static std::mt19937_64 makeRng(const ShuffleConfig &config, const std::uint32_t step, const std::uint32_t index,
+                               const std::uint32_t part) {
+    std::seed_seq seeds{
+        static_cast<std::uint32_t>(config.seed), static_cast<std::uint32_t>(config.seed >> 32), step, index, part
+    };
+    return std::mt19937_64(seeds);
+}
+
+// Appends the records of the file and removes it
+static void readRecords(const std::string &path, std::vector<PackedPosition> &records) {
+    std::ifstream file(path, std::ios::binary);
+    std::error_code error;
+    const std::uint64_t size = std::filesystem::file_size(path, error);
+    if (!file.is_open() || error) {
+        return;
+    }
+
+    const std::size_t offset = records.size();
+    records.resize(offset + size / sizeof(PackedPosition));
+    file.read(reinterpret_cast<char *>(records.data() + offset),
+              static_cast<std::streamsize>((records.size() - offset) * sizeof(PackedPosition)));
+    file.close();
+    std::filesystem::remove(path);
+}
+
+std::vector<std::string> Shuffle::splitBucket(const ShuffleConfig &config, const int bucket,
+                                              const std::vector<std::string> &parts, const std::uint64_t bucketBytes,
+                                              const std::uint64_t memory) {
+    // Twice as many splits as needed, so the random split sizes stay below the memory as well
+    const std::uint64_t splitCount = 2 * bucketBytes / memory + 1;
+    std::mt19937_64 rng = makeRng(config, 1, bucket, 0);
+
+    std::vector<std::string> splits;
+    for (std::uint64_t split = 0; split < splitCount; split++) {
+        splits.push_back(config.outputPath + ".bucket" + std::to_string(bucket) + ".split" + std::to_string(split));
+        std::filesystem::remove(splits.back());
+    }
+
+    // Half of the memory reads the parts, the other half buffers the splits
+    const std::size_t bufferSize = std::max<std::uint64_t>(memory / 2 / splitCount, 1 << 12);
+    std::vector<std::string> buffers(splitCount);
+    auto flush = [&](const std::uint64_t split) {
+        std::ofstream file(splits[split], std::ios::binary | std::ios::app);
+        file.write(buffers[split].data(), static_cast<std::streamsize>(buffers[split].size()));
+        buffers[split].clear();
+    };
+
+    std::vector<PackedPosition> records(std::max<std::uint64_t>(memory / 2 / sizeof(PackedPosition), 1));
+    for (const std::string &path: parts) {
+        std::ifstream file(path, std::ios::binary);
+        while (file) {
+            file.read(reinterpret_cast<char *>(records.data()),
+                      static_cast<std::streamsize>(records.size() * sizeof(PackedPosition)));
+            const std::size_t count = static_cast<std::size_t>(file.gcount()) / sizeof(PackedPosition);
+
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint64_t split = rng() % splitCount;
+                buffers[split].append(reinterpret_cast<const char *>(&records[i]), sizeof(PackedPosition));
+                if (buffers[split].size() >= bufferSize) {
+                    flush(split);
+                }
+            }
+        }
+        file.close();
+        std::filesystem::remove(path);
+    }
+
+    for (std::uint64_t split = 0; split < splitCount; split++) {
+        if (!buffers[split].empty()) {
+            flush(split);
+        }
+    }
+
+    return splits;
+}
+
+std::uint64_t Shuffle::distribute(const ShuffleConfig &config, const int inputIndex, const int bucketCount,
+                                  const std::size_t bufferSize) {
+    const std::string &inputPath = config.inputPaths[inputIndex];
+    std::mt19937_64 rng = makeRng(config, 0, inputIndex, 0);
+
+    const bool keepWhiteWin = config.results.find('w') != std::string::npos;
+    const bool keepDraw = config.results.find('d') != std::string::npos;
+    const bool keepBlackWin = config.results.find('l') != std::string::npos;
+
+    // Every bucket collects its records locally and is appended to the bucket file of this input once full
+    std::vector<std::string> buffers(bucketCount);
+    auto flush = [&](const int bucket) {
+        std::ofstream file(bucketPath(config, inputIndex, bucket), std::ios::binary | std::ios::app);
+        file.write(buffers[bucket].data(), static_cast<std::streamsize>(buffers[bucket].size()));
+        buffers[bucket].clear();
+    };
+
+    std::uint64_t positions = 0;
+    auto addPosition = [&](const Board &board, const int score, const GameResult8 result) {
+        if (config.maxScore > 0 && std::abs(score) > config.maxScore) {
+            return;
+        }
+
+        if (!(result == GameResult8::WHITE_WIN ? keepWhiteWin : result == GameResult8::DRAW ? keepDraw : keepBlackWin)) {
+            return;
+        }
+
+        PackedPosition record{};
+        record.board = PackedBoard::pack(board, result);
+        record.score = static_cast<std::int16_t>(std::clamp(score, -32767, 32767));
+
+        const int bucket = static_cast<int>(rng() % bucketCount);
+        buffers[bucket].append(reinterpret_cast<const char *>(&record), sizeof(record));
+        if (buffers[bucket].size() >= bufferSize) {
+            flush(bucket);
+        }
+        positions++;
+    };
+
+    Board board;
+    if (inputPath.ends_with(".txt")) {
+        std::ifstream input(inputPath);
+        if (!input.is_open()) {
+            std::cerr << "Could not open " << inputPath << std::endl;
+            return 0;
+        }
+
+        std::string line;
+        int score;
+        GameResult8 result;
+        while (std::getline(input, line)) {
+            if (parsePositionText(line, board, score, result)) {
+                addPosition(board, score, result);
+            }
+        }
+    } else {
+        GameReader reader(inputPath);
+        if (!reader.isOpen()) {
+            std::cerr << "Could not open " << inputPath << std::endl;
+            return 0;
+        }
+
+        while (reader.nextGame()) {
+            reader.forEachPosition(board, addPosition);
+        }
+    }
+
+    for (int bucket = 0; bucket < bucketCount; bucket++) {
+        if (!buffers[bucket].empty()) {
+            flush(bucket);
+        }
+    }
+
+    return positions;
+}
+
+std::uint64_t Shuffle::run(const ShuffleConfig &config) {
+    // Estimate the size of the bucket files from the inputs. A game record needs at least 4 bytes
+    // and a text line at least 40 bytes for every position, so this errs on the side of more buckets
+    std::uint64_t estimatedBytes = 0;
+    for (const std::string &path: config.inputPaths) {
+        std::error_code error;
+        const std::uint64_t size = std::filesystem::file_size(path, error);
+        if (!error) {
+            estimatedBytes += size / (path.ends_with(".txt") ? 40 : 4) * sizeof(PackedPosition);
+        }
+    }
+
+    // Every thread shuffles one bucket at a time, so a bucket may use the memory of one thread.
+    // Buckets that still end up larger, e.g. because of the bucket limit, are split again in the second pass
+    const std::uint64_t memoryPerThread = (config.memoryMB << 20) / config.threads;
+    const int bucketCount = static_cast<int>(std::clamp<std::uint64_t>(
+        estimatedBytes / memoryPerThread + 1, 1, MAX_BUCKETS));
+
+    // The write buffers of the first pass share the same memory budget
+    const int inputThreads = std::min(config.threads, static_cast<int>(config.inputPaths.size()));
+    const std::size_t bufferSize = std::clamp<std::uint64_t>(
+        (config.memoryMB << 20) / (inputThreads * bucketCount), 1 << 12, 1 << 20);
+
+    const int inputCount = static_cast<int>(config.inputPaths.size());
+    for (int input = 0; input < inputCount; input++) {
+        for (int bucket = 0; bucket < bucketCount; bucket++) {
+            std::filesystem::remove(bucketPath(config, input, bucket));
+        }
+    }
+
+    // First pass: the inputs are read in parallel and every position lands in a random bucket
+    std::atomic<int> nextInput(0);
+    std::atomic<std::uint64_t> totalPositions(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < inputThreads; i++) {
+        threads.emplace_back([&] {
+            for (int input = nextInput++; input < inputCount; input = nextInput++) {
+                totalPositions += distribute(config, input, bucketCount, bufferSize);
+            }
+        });
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    std::ofstream output(config.outputPath, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        std::cerr << "Could not open " << config.outputPath << std::endl;
+        return 0;
+    }
+
+    // Second pass: every bucket fits into memory, so it is shuffled there and appended to the output.
+    // Random buckets that are shuffled on their own are a uniform shuffle of all positions. The buckets
+    // are still written in order, so the output only depends on the seed and not on the threads
+    std::mutex outputLock;
+    std::condition_variable outputTurn;
+    int nextWrite = 0;
+    std::atomic<int> nextBucket(0);
+    for (int i = 0; i < config.threads; i++) {
+        threads.emplace_back([&] {
+            std::vector<PackedPosition> records;
+            std::string buffer;
+            Board board;
+
+            for (int bucket = nextBucket++; bucket < bucketCount; bucket = nextBucket++) {
+                // The parts of the inputs are read in input order, independent of who wrote them first
+                std::vector<std::string> parts;
+                std::uint64_t bucketBytes = 0;
+                for (int input = 0; input < inputCount; input++) {
+                    const std::string path = bucketPath(config, input, bucket);
+                    std::error_code error;
+                    const std::uint64_t size = std::filesystem::file_size(path, error);
+                    if (!error) {
+                        parts.push_back(path);
+                        bucketBytes += size;
+                    }
+                }
+
+                // A bucket above the memory is split into random parts that are shuffled one after the other
+                std::vector<std::vector<std::string>> groups;
+                if (bucketBytes > memoryPerThread) {
+                    std::vector<PackedPosition>().swap(records);
+                    for (const std::string &split: splitBucket(config, bucket, parts, bucketBytes, memoryPerThread)) {
+                        groups.push_back({split});
+                    }
+                } else {
+                    groups.push_back(parts);
+                }
+
+                for (std::size_t group = 0; group < groups.size(); group++) {
+                    records.clear();
+                    for (const std::string &path: groups[group]) {
+                        readRecords(path, records);
+                    }
+
+                    std::mt19937_64 rng = makeRng(config, 2, bucket, static_cast<std::uint32_t>(group));
+                    std::shuffle(records.begin(), records.end(), rng);
+
+                    buffer.clear();
+                    if (config.binaryOutput) {
+                        buffer.assign(reinterpret_cast<const char *>(records.data()),
+                                      records.size() * sizeof(PackedPosition));
+                    } else {
+                        for (const PackedPosition &record: records) {
+                            record.board.unpack(board);
+                            appendPositionText(buffer, board, record.score, record.board.result);
+                        }
+                    }
+
+                    // Only the thread whose bucket is next may write, it keeps the turn for all of its groups
+                    if (group == 0) {
+                        std::unique_lock lock(outputLock);
+                        outputTurn.wait(lock, [&] { return nextWrite == bucket; });
+                    }
+                    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                }
+
+                std::lock_guard lock(outputLock);
+                nextWrite++;
+                outputTurn.notify_all();
+            }
+        });
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    return totalPositions;
+}
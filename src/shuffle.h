@@ -0,0 +1,75 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gamerecord.h"
+
+struct ShuffleConfig {
+    // Binary game records, or 'FEN | score | result' text if the name ends with .txt
+    std::vector<std::string> inputPaths;
+    std::string outputPath;
+    // Write PackedPosition records instead of text lines
+    bool binaryOutput = false;
+    int threads = 1;
+    // Upper bound for the positions every thread holds in memory at once
+    std::uint64_t memoryMB = 1024;
+    std::uint64_t seed = 0;
+
+    // Positions with a higher absolute score are dropped, 0 keeps every position
+    int maxScore = 0;
+    // The results to keep, 'w' for a white win, 'd' for a draw and 'l' for a black win
+    std::string results = "wdl";
+};
+
+// Shuffles training data that does not fit into memory. Every position is first written to a random
+// bucket file, then the buckets are shuffled in memory one after the other and appended to the output.
+// Multiple inputs, like the shards of a datagen run, are interleaved on the way.
+// Every input has its own bucket files and the buckets are written in order, so a seed gives the same
+// output again. The bucket count follows the memory of one thread, so memory_mb / threads has to match as well
+class Shuffle {
+public:
+    // Parses 'in=a.bin,b.bin out=path format=text|binary threads=N memory_mb=M seed=S max_score=S results=wdl'
+    static void handleShuffle(std::istringstream &is);
+
+    // Returns the amount of positions written
+    static std::uint64_t run(const ShuffleConfig &config);
+
+private:
+    static constexpr int MAX_BUCKETS = 1024;
+
+    // Streams the positions of one input into the bucket files
+    static std::uint64_t distribute(const ShuffleConfig &config, int inputIndex, int bucketCount,
+                                    std::size_t bufferSize);
+
+    static std::string bucketPath(const ShuffleConfig &config, int inputIndex, int bucket);
+
+    // Distributes a bucket that does not fit into the memory to smaller files and returns their paths
+    static std::vector<std::string> splitBucket(const ShuffleConfig &config, int bucket,
+                                                const std::vector<std::string> &parts, std::uint64_t bucketBytes,
+                                                std::uint64_t memory);
+};
+
+#endif
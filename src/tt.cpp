@@ -61,8 +61,8 @@ void tt::init(const std::uint64_t MB) {
 
     size >>= 1;
 
+    // calloc already hands out zeroed memory, so we don't need to clear the table
     table = static_cast<Hash *>(calloc(size, sizeof(Hash)));
-    clear();
 }
 
 void tt::setSize(const std::uint64_t MB) {
@@ -55,6 +55,11 @@ public:
 
     [[nodiscard]] Hash *getHash(std::uint64_t zobristKey) const noexcept;
 
+    // Starts loading the entry of a position we are about to search, so the probe does not stall
+    void prefetch(const std::uint64_t zobristKey) const noexcept {
+        __builtin_prefetch(table + zobristKey % size);
+    }
+
     void setSize(std::uint64_t MB);
 
     void clear() const;
@@ -12,6 +12,7 @@ DEFINE_PARAM(seeQuiet, -20, -45, -5);
 DEFINE_PARAM(seeNonQuiet, -90, -120, 50);
 DEFINE_PARAM(seDepthSub, 3, 2, 4);
 DEFINE_PARAM(seNewDepthSub, 1, 1, 2);
+DEFINE_PARAM(qsFpMargin, 100, 50, 200);
 DEFINE_PARAM(aspBase, 25, 15, 35);
 DEFINE_PARAM(materialBase, 160, 100, 220);
 DEFINE_PARAM(materialDiv, 270, 225, 315);
@@ -0,0 +1,80 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "worker.h"
+
+SearchWorker::SearchWorker(Search &engine, Board &position, SearchParams &searchParams)
+    : search(engine), board(position), params(searchParams) {
+    // The thread is started last, so every member is initialized before it runs
+    thread = std::thread(&SearchWorker::idleLoop, this);
+}
+
+SearchWorker::~SearchWorker() {
+    stopSearch();
+    waitForSearch();
+
+    {
+        std::lock_guard lock(mutex);
+        quit = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void SearchWorker::startSearch() {
+    {
+        std::lock_guard lock(mutex);
+        search.shouldStop = false;
+        searching = true;
+    }
+    condition.notify_all();
+}
+
+void SearchWorker::stopSearch() {
+    std::lock_guard lock(mutex);
+    if (searching) {
+        search.shouldStop = true;
+    }
+}
+
+void SearchWorker::waitForSearch() {
+    std::unique_lock lock(mutex);
+    condition.wait(lock, [this] { return !searching; });
+}
+
+void SearchWorker::idleLoop() {
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this] { return searching || quit; });
+
+            if (quit) {
+                return;
+            }
+        }
+
+        search.iterativeDeepening(board, params);
+
+        {
+            std::lock_guard lock(mutex);
+            searching = false;
+        }
+        condition.notify_all();
+    }
+}
@@ -0,0 +1,64 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "search.h"
+
+// A thread that lives as long as the engine and sleeps until the next 'go'.
+// Starting a search only wakes the thread, so short searches don't pay for creating a new thread
+class SearchWorker {
+public:
+    SearchWorker(Search &engine, Board &position, SearchParams &searchParams);
+
+    ~SearchWorker();
+
+    SearchWorker(const SearchWorker &) = delete;
+    SearchWorker &operator=(const SearchWorker &) = delete;
+
+    // Wakes the worker to search the board with the params. No search is allowed to run
+    void startSearch();
+
+    // Tells the running search to stop, but doesn't wait for it
+    void stopSearch();
+
+    // Blocks until the worker is idle again
+    void waitForSearch();
+
+private:
+    void idleLoop();
+
+    Search &search;
+    Board &board;
+    SearchParams &params;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool searching = false;
+    bool quit = false;
+
+    std::thread thread;
+};
+
+#endif